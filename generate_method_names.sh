@@ -10,6 +10,8 @@ consts="${consts// with /_}"
 consts="${consts//\(/}"
 consts="${consts//\)/}"
 consts="${consts// /}"
+# anything else that cannot be in a Python identifier
+consts="${consts//[^A-Za-z0-9_$'\n']/_}"
 consts="${consts^^}"
 array=$(sed 's/.*/    &,/' <(echo "$consts"))
 consts=$(sed 's/.*/& /' <(echo "$consts"))
@@ -0,0 +1,35 @@
+#pragma once
+#include "buffer.hpp"
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Monotonic scratch memory for the intermediates of a single compress or decompress call, drawn from the buffer pool.
+// Allocations are uninitialised and only released together by reset(). Anything that did not fit in the main block
+// comes from overflow blocks, and reset() then grows the main block to the previous call's high-water mark, so calls
+// no larger than an earlier one allocate nothing.
+class Arena
+{
+    static constexpr size_t alignment = buffer_pool::alignment;
+
+    pooled_array<std::byte> block;
+    size_t used = 0;
+    std::vector<pooled_array<std::byte>> overflow;
+    size_t overflow_size = 0;
+
+    std::byte *allocate_bytes(size_t size);
+
+  public:
+    void reset();
+    size_t capacity() const
+    {
+        return block.size();
+    }
+
+    template <typename T> std::span<T> allocate(size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= alignment);
+        return std::span<T>(reinterpret_cast<T *>(allocate_bytes(count * sizeof(T))), count);
+    }
+};
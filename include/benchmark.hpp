@@ -1,4 +1,5 @@
 #pragma once
+#include "profile.hpp"
 #include <span>
 #include <string>
 #include <vector>
@@ -23,6 +24,16 @@ struct bench_result
 struct bench_result_ex : bench_result
 {
     std::string name;
+    std::string dataset;
+    double error_bound = 0;
+    // where the result sits in a sharded benchmark matrix, see matrix.hpp
+    std::string matrix_id;
+    size_t matrix_index = 0;
+    size_t matrix_size = 0;
+    std::string shard;
+    // characteristics of the input, the same for every result on a dataset
+    data_profile profile;
+
     double mbytes()
     {
         return (double)(original_size) / (1024.0l * 1024.0l);
@@ -39,6 +50,21 @@ struct bench_result_ex : bench_result
     std::string to_string();
 };
 
+// Names and dataset paths go into the csv unquoted, so they must not hold a comma or a line break.
+bool csv_field_ok(const std::string &field);
+void results_to_file(std::string path, std::vector<bench_result_ex> &results);
+std::vector<bench_result_ex> results_from_file(std::string path);
+
+struct link_cost
+{
+    double bandwidth; // bytes per second
+    double transfer_time;
+    double sequential_time;
+    double pipelined_time;
+};
+
+link_cost estimate_link_cost(const bench_result &result, double bandwidth);
+
 template <typename F>
 bench_result_ex benchmark(std::span<const F> original_buffer, Method<F> &method, F error_bound = 1.0,
                           std::span<F> output_buffer = std::span<F>(), bool quiet = false, bool skip_metrics = false);
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct buffer_pool_stats
+{
+    size_t allocations = 0;     // blocks obtained from the system
+    size_t reuses = 0;          // requests served from the cache
+    size_t huge_blocks = 0;     // allocations backed by MAP_HUGETLB
+    size_t thp_blocks = 0;      // allocations advised for transparent huge pages
+    size_t bytes_in_use = 0;    // size of the blocks currently handed out
+    size_t peak_bytes_in_use = 0;
+    size_t bytes_cached = 0;    // size of the released blocks kept for reuse
+};
+
+// Process-wide pool of 64-byte aligned blocks shared by every Encoding and Method. Requests are rounded up to a size
+// class, powers of two below the huge page threshold and multiples of 2 MiB above it. Blocks above the threshold are
+// mapped with MAP_HUGETLB when the system has huge pages reserved and advised for transparent huge pages otherwise.
+// Released blocks are cached per class up to the cache limit. All functions are thread safe.
+namespace buffer_pool
+{
+constexpr size_t alignment = 64;
+
+void *allocate(size_t size);
+void release(void *ptr);
+buffer_pool_stats stats();
+// returns every cached block to the system
+void trim();
+void set_cache_limit(size_t bytes);
+void set_huge_page_threshold(size_t bytes);
+} // namespace buffer_pool
+
+template <typename T> struct pool_allocator
+{
+    typedef T value_type;
+
+    pool_allocator() = default;
+    template <typename U> pool_allocator(const pool_allocator<U> &)
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(buffer_pool::allocate(n * sizeof(T)));
+    }
+    void deallocate(T *ptr, size_t)
+    {
+        buffer_pool::release(ptr);
+    }
+
+    template <typename U> bool operator==(const pool_allocator<U> &) const
+    {
+        return true;
+    }
+};
+
+// Allocator that default-initialises elements, so resizing a byte vector does not zero memory that is about to be
+// overwritten anyway.
+template <typename T, typename A = std::allocator<T>> class default_init_allocator : public A
+{
+    typedef std::allocator_traits<A> a_t;
+
+  public:
+    template <typename U> struct rebind
+    {
+        using other = default_init_allocator<U, typename a_t::template rebind_alloc<U>>;
+    };
+
+    using A::A;
+
+    template <typename U> void construct(U *ptr) noexcept(std::is_nothrow_default_constructible<U>::value)
+    {
+        ::new (static_cast<void *>(ptr)) U;
+    }
+    template <typename U, typename... Args> void construct(U *ptr, Args &&...args)
+    {
+        a_t::construct(static_cast<A &>(*this), ptr, std::forward<Args>(args)...);
+    }
+};
+
+// vector whose storage comes from the buffer pool and is left uninitialised on resize
+template <typename T> using pooled_vector = std::vector<T, default_init_allocator<T, pool_allocator<T>>>;
+
+typedef pooled_vector<std::byte> byte_buffer;
+
+// Fixed size, uninitialised array from the buffer pool.
+template <typename T> class pooled_array
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    T *ptr = nullptr;
+    size_t count = 0;
+
+  public:
+    pooled_array() = default;
+    explicit pooled_array(size_t count)
+        : ptr(count ? static_cast<T *>(buffer_pool::allocate(count * sizeof(T))) : nullptr), count(count)
+    {
+    }
+    pooled_array(pooled_array &&other) noexcept
+        : ptr(std::exchange(other.ptr, nullptr)), count(std::exchange(other.count, 0))
+    {
+    }
+    pooled_array &operator=(pooled_array &&other) noexcept
+    {
+        std::swap(ptr, other.ptr);
+        std::swap(count, other.count);
+        return *this;
+    }
+    pooled_array(const pooled_array &) = delete;
+    pooled_array &operator=(const pooled_array &) = delete;
+    ~pooled_array()
+    {
+        if (ptr)
+            buffer_pool::release(ptr);
+    }
+
+    T *get() const
+    {
+        return ptr;
+    }
+    size_t size() const
+    {
+        return count;
+    }
+    std::span<T> span() const
+    {
+        return std::span<T>(ptr, count);
+    }
+    T &operator[](size_t i) const
+    {
+        return ptr[i];
+    }
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct bench_result_ex;
+
+struct corpus_file
+{
+    std::string path;
+    char dtype = 'f';        // 'f' for float, 'd' for double
+    size_t offset = 0;       // bytes to skip, the header of a .npy file
+    std::vector<double> error_bounds; // empty to use the bounds given on the command line
+};
+
+// Describes a single raw (.f32, .f64, .bin, .raw, .dat) or .npy array. Raw files are floats unless they end in .f64.
+corpus_file describe_file(const std::string &path);
+
+// Lists the arrays of a corpus, either every array in a directory (in name order) or the entries of a manifest with
+// one "<path> [dtype] [error bound]" line per array. Paths in a manifest are relative to the manifest.
+std::vector<corpus_file> load_corpus(const std::string &path);
+
+// Reads the values of a file only when it is needed so a corpus never has to fit in memory.
+template <typename F> std::vector<F> read_corpus_file(const corpus_file &file);
+
+struct corpus_aggregate
+{
+    std::string name;
+    std::string error_bound;
+    size_t files = 0;
+    size_t original_size = 0;
+    size_t compressed_size = 0;
+    double ratio_geomean = 0;
+    double compression_rate_geomean = 0;   // MB/s
+    double decompression_rate_geomean = 0; // MB/s
+    double compression_time = 0;
+    double decompression_time = 0;
+
+    // size weighted values are totals over the whole corpus
+    double ratio_weighted()
+    {
+        return (double)compressed_size / original_size;
+    }
+    double compression_rate_weighted()
+    {
+        return original_size / (1024.0l * 1024.0l) / compression_time;
+    }
+    double decompression_rate_weighted()
+    {
+        return original_size / (1024.0l * 1024.0l) / decompression_time;
+    }
+};
+
+// Aggregates results per method and error bound, in the order the methods first appear. Error bounds are matched by
+// their position in each file's list so per-file bounds from a manifest aggregate together.
+std::vector<corpus_aggregate> aggregate_corpus(std::vector<bench_result_ex> &results,
+                                               const std::vector<corpus_file> &files, std::vector<double> error_bounds);
@@ -3,71 +3,189 @@ extern "C"
 {
 #include "cpcodec.h"
 }
+#include "buffer.hpp"
+#include "thread_local.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <memory>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+// Encodings are safe to share between threads: configuration is fixed at construction and any scratch state is kept
+// per thread.
 class Encoding
 {
+    struct buffers
+    {
+        byte_buffer encoded;
+        byte_buffer decoded;
+        byte_buffer gathered;
+    };
+    ThreadLocal<buffers> thread_buffers;
+
   public:
     virtual std::string name() = 0;
-    virtual std::span<const std::byte> encode(std::span<const std::byte> input) = 0;
-    virtual std::span<const std::byte> decode(std::span<const std::byte> input) = 0;
+    // Upper bound on the bytes encode_into writes for input_size bytes of input.
+    virtual size_t max_encoded_size(size_t input_size) = 0;
+    // Number of bytes decode_into writes for this encoded input.
+    virtual size_t decoded_size(std::span<const std::byte> input) = 0;
+    // Encode or decode into a caller provided buffer and return the number of bytes written. If the buffer is too
+    // small the return value is the size needed instead, which is always larger than output.size().
+    virtual size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) = 0;
+    virtual size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) = 0;
+    // As above but into storage owned by the encoding, valid until the calling thread's next call.
+    virtual std::span<const std::byte> encode(std::span<const std::byte> input);
+    virtual std::span<const std::byte> decode(std::span<const std::byte> input);
+    // Encode the concatenation of segments, in the same format as encode_into. The default gathers them into a
+    // scratch buffer first; encodings with a streaming API read them in place.
+    virtual size_t encode_segments_into(std::span<const std::span<const std::byte>> segments,
+                                        std::span<std::byte> output);
+    std::span<const std::byte> encode_segments(std::span<const std::span<const std::byte>> segments);
     virtual ~Encoding(){};
 };
 
+// The default is the BWT with the fast QLFC coder and no LZP preprocessing.
+struct bsc_params
+{
+    int block_sorter = 1;       // LIBBSC_BLOCKSORTER_*: 1 is the BWT, 3 to 8 the sort transform of that order
+    int coder = 3;              // LIBBSC_CODER_QLFC_*: 1 static, 2 adaptive, 3 fast
+    int lzp_hash_size = 0;      // LZP hash table bits, 10 to 28, zero together with lzp_min_len disables LZP
+    int lzp_min_len = 0;        // shortest LZP match, 4 to 255
+    bool multithreaded = false; // let libbsc sort and code one block with OpenMP threads
+};
+
+// Encodes the whole input as one bsc block. Settings other than the defaults appear in the name.
 class Bsc : public Encoding
 {
-    std::vector<std::byte> compressed_buffer;
-    std::vector<std::byte> decompressed_buffer;
+    bsc_params params;
+
+    int features() const;
 
   public:
-    std::string name() override
+    Bsc();
+    explicit Bsc(bsc_params params);
+    std::string name() override;
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+};
+
+typedef struct ZSTD_CCtx_s ZSTD_CCtx;
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+typedef struct ZSTD_CDict_s ZSTD_CDict;
+typedef struct ZSTD_DDict_s ZSTD_DDict;
+
+// Zero leaves a parameter to the compression level.
+struct zstd_params
+{
+    int level = 3;        // negative levels are the fast modes
+    int strategy = 0;     // ZSTD_strategy, 1 (fast) to 9 (btultra2)
+    int window_log = 0;
+    int hash_log = 0;
+    int literal_mode = 0; // ZSTD_paramSwitch_e: 1 always Huffman codes literals, 2 stores them raw
+    int workers = 0;      // zstd's own compression threads, -1 for threads_per_job()
+    int job_size = 0;     // bytes per worker job
+    int overlap_log = 0;  // how much of the previous job each job reloads, 1 (none) to 9 (a full window)
+    bool long_distance = false;
+};
+
+// A zstd dictionary, trained with ZDICT on sample blocks of similar data. It is saved as the bare dictionary, the
+// format the zstd command line tool reads with -D.
+class ZstdDictionary
+{
+    std::vector<std::byte> content;
+
+  public:
+    explicit ZstdDictionary(std::vector<std::byte> content);
+    // trains on the block_size blocks of data, evenly spaced ones if there are more than 100 times capacity bytes
+    static ZstdDictionary train(std::span<const std::byte> data, size_t block_size, size_t capacity = 110 << 10);
+    static ZstdDictionary load(const std::string &path);
+    void save(const std::string &path) const;
+    std::span<const std::byte> bytes() const
     {
-        return "Bsc";
-    };
-    std::span<const std::byte> encode(std::span<const std::byte> input) override;
-    std::span<const std::byte> decode(std::span<const std::byte> input) override;
+        return content;
+    }
 };
 
+// Zstd with per-thread compression and decompression contexts that are created once and reused for every call.
+// Parameters other than the level appear in the name when they are set. With a dictionary every frame starts from the
+// dictionary, which is digested once into a CDict and a DDict shared by all threads; the CDict's parameters come from
+// the level and replace strategy, window log and hash log.
 class Zstd : public Encoding
 {
-    std::vector<std::byte> compressed_buffer;
-    std::vector<std::byte> decompressed_buffer;
+    struct context;
+    ThreadLocal<context> contexts;
+    zstd_params params;
+    std::shared_ptr<const ZstdDictionary> dictionary;
+    ZSTD_CDict *cdict = nullptr;
+    ZSTD_DDict *ddict = nullptr;
+
+    context &get_context();
+    int worker_count() const;
 
   public:
+    Zstd();
+    explicit Zstd(zstd_params params);
+    Zstd(zstd_params params, std::shared_ptr<const ZstdDictionary> dictionary);
+    ~Zstd() override;
+    // applies the parameters to a context from ZSTD_createCCtx or ZSTD_createDCtx
+    void configure(ZSTD_CCtx *cctx) const;
+    void configure(ZSTD_DCtx *dctx) const;
     std::string name() override;
-    std::span<const std::byte> encode(std::span<const std::byte> input) override;
-    std::span<const std::byte> decode(std::span<const std::byte> input) override;
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t encode_segments_into(std::span<const std::span<const std::byte>> segments,
+                                std::span<std::byte> output) override;
 };
 
+struct lz4_params
+{
+    int acceleration = 1;     // LZ4_compress_fast, 1 (default) to 65537 (fastest)
+    int hc_level = 0;         // LZ4HC level 3 to 12 instead of the fast compressor
+    size_t linked_block = 0;  // compress as a stream of blocks of this size that refer back into earlier blocks
+};
+
+// Lz4 with per-thread compression states that are reset rather than initialised for every call. In linked mode the
+// input is compressed as successive blocks of one lz4 stream, each prefixed with its int32 compressed size, the way a
+// series arriving in chunks would be; the output is [input size][uint32 block size][blocks].
 class Lz4 : public Encoding
 {
-    std::vector<std::byte> compressed_buffer;
-    std::vector<std::byte> decompressed_buffer;
+    struct context;
+    ThreadLocal<context> contexts;
+    lz4_params params;
+
+    context &get_context();
 
   public:
-    std::string name() override
-    {
-        return "Lz4";
-    };
-    std::span<const std::byte> encode(std::span<const std::byte> input) override;
-    std::span<const std::byte> decode(std::span<const std::byte> input) override;
+    Lz4();
+    explicit Lz4(lz4_params params);
+    ~Lz4() override;
+    std::string name() override;
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
 };
 
 class Snappy : public Encoding
 {
-    std::vector<std::byte> compressed_buffer;
-    std::vector<std::byte> decompressed_buffer;
-
   public:
     std::string name() override
     {
         return "Snappy";
     };
-    std::span<const std::byte> encode(std::span<const std::byte> input) override;
-    std::span<const std::byte> decode(std::span<const std::byte> input) override;
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
 };
 
 enum PcodecEncType
@@ -77,72 +195,384 @@ enum PcodecEncType
     p_int
 };
 
+// Pcodec through its C FFI, which compresses a whole array as one standalone stream and always returns a newly boxed
+// result, so the chunk size and the parallelism come from wrapping it in Chunked. A level other than the default 8
+// appears in the name.
 template <typename T, PcodecEncType P> class Pcodec : public Encoding
 {
-    PcoFfiVec enc_vec = {};
-    PcoFfiVec dec_vec = {};
+    struct context
+    {
+        PcoFfiVec enc_vec = {};
+        PcoFfiVec dec_vec = {};
+        ~context();
+    };
+    ThreadLocal<context> contexts;
+    unsigned level;
+
+    void decompress(context &ctx, std::span<const std::byte> input);
 
   public:
+    // level 0 to 12, higher levels search harder for the number format
+    explicit Pcodec(unsigned level = 8);
     std::string name() override
     {
-        if (P == p_int)
-            return "Pcodec (int)";
-        if (P == p_uint)
-            return "Pcodec (uint)";
-        if (P == p_float)
-            return "Pcodec";
+        std::string options = P == p_int ? "int" : P == p_uint ? "uint" : "";
+        if (level != 8)
+            options += (options.empty() ? "level " : " level ") + std::to_string(level);
+        return options.empty() ? "Pcodec" : "Pcodec (" + options + ")";
     };
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
     std::span<const std::byte> encode(std::span<const std::byte> input) override;
     std::span<const std::byte> decode(std::span<const std::byte> input) override;
-    ~Pcodec();
 };
 
+// Gorilla over independent blocks of block_values values, encoded and decoded in parallel on the shared thread pool.
+// The output is [input size][block values][block count][block count + 1 offsets][blocks], offsets counted from the
+// first block, so the total is not limited to 4 GiB and any block can be decoded on its own. A block length other than
+// the default appears in the name.
 template <typename T> class Gorilla : public Encoding
 {
-    std::vector<std::byte> compressed_buffer;
-    std::vector<std::byte> decompressed_buffer;
+    size_t block_values;
+
+    size_t block_count(size_t values) const
+    {
+        return (values + block_values - 1) / block_values;
+    }
 
   public:
+    static constexpr size_t default_block_values = size_t(1) << 20;
+    // keeps a block's worst case size within the 32-bit sizes of the bitstream
+    static constexpr size_t max_block_values = size_t(1) << 24;
+    explicit Gorilla(size_t block_values = default_block_values);
     std::string name() override
     {
-        return "Gorilla";
+        if (block_values == default_block_values)
+            return "Gorilla";
+        return "Gorilla (blocks of " + std::to_string(block_values) + ")";
     };
-    std::span<const std::byte> encode(std::span<const std::byte> input) override;
-    std::span<const std::byte> decode(std::span<const std::byte> input) override;
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+};
+
+// Chimp XOR encoding (Liakos et al., VLDB 2022). Like Gorilla it stores each value's XOR with an earlier one, but the
+// leading zero count is rounded to one of eight values, and XORs ending in many zero bits get a code that drops them.
+// With References = 128 (Chimp128) a value is XORed with whichever of the last 128 values shares its low bits, found
+// through a hash table of the low bits, when that leaves more trailing zeros. The output is [input size][first
+// value][bitstream].
+template <typename T, unsigned References> class ChimpN : public Encoding
+{
+    static_assert(References > 0 && References <= 128 && (References & (References - 1)) == 0);
+
+  public:
+    std::string name() override
+    {
+        return References == 1 ? "Chimp" : "Chimp" + std::to_string(References);
+    };
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+};
+template <typename T> using Chimp = ChimpN<T, 1>;
+template <typename T> using Chimp128 = ChimpN<T, 128>;
+
+// FPC (Burtscher and Ratanaworabhan, 2009). Each value is predicted by two hash tables of 2^table_bits entries, an FCM
+// indexed by a hash of the recent values and a DFCM indexed by a hash of the recent differences, and the XOR with the
+// closer prediction is stored without its leading zero bytes. A header byte holds the predictor and the zero byte count
+// for a pair of values. Single stream and sequential; Chunked<Fpc> encodes blocks in parallel. Inputs with fewer values
+// than the table use a smaller one. The output is [input size][table bits][pairs]. A table size other than the default
+// appears in the name.
+template <typename T> class Fpc : public Encoding
+{
+    unsigned table_bits;
+
+  public:
+    static constexpr unsigned default_table_bits = 16;
+    static constexpr unsigned max_table_bits = 24;
+    explicit Fpc(unsigned table_bits = default_table_bits);
+    // the table size as bits, names have to stay Python identifiers in generate_method_names.sh
+    std::string name() override
+    {
+        if (table_bits == default_table_bits)
+            return "FPC";
+        return "FPC (table " + std::to_string(table_bits) + " bits)";
+    };
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+};
+
+// ALP, adaptive lossless floating point (Afroozeh et al., SIGMOD 2024). Values that are decimals at heart are scaled by
+// a power of ten chosen per vector of 1024 from sampled candidates, rounded to integers and bit-packed with a frame of
+// reference; values that do not survive the round trip are stored as exceptions. Row groups of 100 vectors whose
+// sample does not suit that use ALP_rd instead, which packs the low bits as they are and codes the high 16 or fewer
+// through a dictionary of 8. A vector that neither makes smaller is stored raw. The output is [input size][row groups].
+template <typename T> class Alp : public Encoding
+{
+  public:
+    std::string name() override
+    {
+        return "ALP";
+    };
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
 };
 
 template <typename T> std::vector<std::byte> streamsplit_enc(std::span<const std::byte> input);
 template <typename T> std::vector<std::byte> streamsplit_dec(std::span<const std::byte> input);
+template <typename T> void streamsplit_enc_into(std::span<const std::byte> input, std::span<std::byte> output);
+template <typename T> void streamsplit_dec_into(std::span<const std::byte> input, std::span<std::byte> output);
+// decodes values [first, first + output.size() / sizeof(T)) of a stream split buffer
+template <typename T>
+void streamsplit_dec_range(std::span<const std::byte> input, size_t first, std::span<std::byte> output);
 template <typename T> class StreamSplit : public Encoding
 {
-    std::vector<std::byte> encoded_buffer;
-    std::vector<std::byte> decoded_buffer;
-
   public:
     std::string name() override
     {
         return "Stream Split (" + std::to_string(sizeof(T)) + ")";
     };
-    std::span<const std::byte> encode(std::span<const std::byte> input) override;
-    std::span<const std::byte> decode(std::span<const std::byte> input) override;
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+};
+
+// Stream split fused with a streaming backend (Zstd or Lz4): the input is split and compressed one cache sized tile at
+// a time, and decoded tiles are un-split straight into the output, so no full size split copy is ever made. Planes are
+// split per tile, so the output differs from Compose<StreamSplit<T>, B>; it starts with [input size][version][tile
+// size].
+template <typename T, typename B> class TiledSplit : public Encoding
+{
+    struct context;
+    ThreadLocal<context> contexts;
+    B backend;
+    size_t tile_size;
+
+  public:
+    // half the L2 cache, so a tile and its split copy stay in it together, or 512 KiB if the size is unknown
+    static size_t default_tile_size();
+    // tile_size is rounded up to a multiple of 64 bytes
+    explicit TiledSplit(size_t tile_size = default_tile_size());
+    ~TiledSplit() override;
+    std::string name() override
+    {
+        return "Tiled Stream Split (" + std::to_string(sizeof(T)) + ") with " + backend.name();
+    };
+    size_t max_encoded_size(size_t input_size) override;
+    size_t decoded_size(std::span<const std::byte> input) override;
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override;
 };
 
+// E1 then E2. The output is [input size][E2's output], so sizing a decode does not need E2 to decode first.
 template <typename E1, typename E2> class Compose : public Encoding
 {
     E1 e1;
     E2 e2;
+    ThreadLocal<byte_buffer> scratch_buffers;
 
   public:
+    Compose() = default;
+    // constructs the second stage from args, e.g. a Zstd with non-default parameters
+    template <typename Arg, typename... Args>
+    explicit Compose(Arg &&arg, Args &&...args) : e2(std::forward<Arg>(arg), std::forward<Args>(args)...)
+    {
+    }
     std::string name() override
     {
         return e1.name() + " with " + e2.name();
     };
-    std::span<const std::byte> encode(std::span<const std::byte> input) override
+    size_t max_encoded_size(size_t input_size) override
     {
-        return e2.encode(e1.encode(input));
+        return sizeof(size_t) + e2.max_encoded_size(e1.max_encoded_size(input_size));
+    }
+    size_t decoded_size(std::span<const std::byte> input) override
+    {
+        if (input.size() < sizeof(size_t))
+            throw std::runtime_error("Truncated composed input");
+        size_t result_sz;
+        std::memcpy(&result_sz, input.data(), sizeof(size_t));
+        return result_sz;
+    }
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override
+    {
+        size_t input_sz = input.size_bytes();
+        if (output.size() < sizeof(size_t))
+            return max_encoded_size(input_sz);
+        byte_buffer &scratch = scratch_buffers.get();
+        scratch.resize(e1.max_encoded_size(input.size_bytes()));
+        size_t size = e1.encode_into(input, scratch);
+        if (size > scratch.size())
+        {
+            scratch.resize(size);
+            size = e1.encode_into(input, scratch);
+        }
+        size = e2.encode_into(std::span<const std::byte>(scratch).first(size), output.subspan(sizeof(size_t)));
+        if (size > output.size() - sizeof(size_t))
+            return size + sizeof(size_t);
+        std::memcpy(output.data(), &input_sz, sizeof(size_t));
+        return size + sizeof(size_t);
+    }
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override
+    {
+        size_t result_sz = decoded_size(input);
+        if (output.size() < result_sz)
+            return result_sz;
+        if (e1.decode_into(e2.decode(input.subspan(sizeof(size_t))), output.first(result_sz)) != result_sz)
+            throw std::runtime_error("Composed input decoded to the wrong size");
+        return result_sz;
     }
     std::span<const std::byte> decode(std::span<const std::byte> input) override
     {
-        return e1.decode(e2.decode(input));
+        // the stored size is only checked here, e1 sizes its own output
+        decoded_size(input);
+        return e1.decode(e2.decode(input.subspan(sizeof(size_t))));
+    }
+};
+
+// Encodes the input as independent blocks of block_size bytes, in parallel on the shared thread pool. The output is
+// [input size][block size][block count][block count + 1 offsets][blocks], offsets counted from the first block, so
+// every block can be decoded on its own and decoding runs in parallel as well.
+template <typename E> class Chunked : public Encoding
+{
+    E e;
+    size_t block_size;
+
+    static size_t header_size(size_t blocks)
+    {
+        return (blocks + 4) * sizeof(size_t);
+    }
+    size_t block_count(size_t input_size) const
+    {
+        return (input_size + block_size - 1) / block_size;
+    }
+    std::span<const std::byte> block(std::span<const std::byte> input, size_t i) const
+    {
+        return input.subspan(i * block_size, std::min(block_size, input.size() - i * block_size));
+    }
+    static size_t read(std::span<const std::byte> input, size_t i)
+    {
+        if (input.size() < (i + 1) * sizeof(size_t))
+            throw std::runtime_error("Truncated chunked header");
+        size_t value;
+        std::memcpy(&value, input.data() + i * sizeof(size_t), sizeof(size_t));
+        return value;
+    }
+
+  public:
+    // block_size is rounded up to a multiple of 64 bytes, so blocks never split an element
+    explicit Chunked(size_t block_size = size_t(1) << 20) : block_size((std::max<size_t>(block_size, 1) + 63) / 64 * 64)
+    {
+    }
+    // constructs the block encoding from args, e.g. a Bsc with non-default parameters
+    template <typename Arg, typename... Args>
+    Chunked(size_t block_size, Arg &&arg, Args &&...args)
+        : e(std::forward<Arg>(arg), std::forward<Args>(args)...),
+          block_size((std::max<size_t>(block_size, 1) + 63) / 64 * 64)
+    {
+    }
+    std::string name() override
+    {
+        return "Chunked " + e.name() + " (" + std::to_string(block_size >> 10) + " KiB)";
+    };
+    size_t max_encoded_size(size_t input_size) override
+    {
+        size_t blocks = block_count(input_size);
+        if (blocks == 0)
+            return header_size(0);
+        size_t last = input_size - (blocks - 1) * block_size;
+        return header_size(blocks) + (blocks - 1) * e.max_encoded_size(block_size) + e.max_encoded_size(last);
+    }
+    size_t decoded_size(std::span<const std::byte> input) override
+    {
+        return read(input, 0);
+    }
+    size_t encode_into(std::span<const std::byte> input, std::span<std::byte> output) override
+    {
+        size_t needed = max_encoded_size(input.size_bytes());
+        if (output.size() < needed)
+            return needed;
+
+        // every block is encoded into a worst-case slot, then the blocks are moved together
+        size_t blocks = block_count(input.size_bytes());
+        size_t start = header_size(blocks);
+        size_t slot_size = e.max_encoded_size(block_size);
+        std::vector<size_t> sizes(blocks);
+        std::vector<byte_buffer> spilled(blocks); // for the rare block that outgrows its estimate
+        ThreadPool::shared().run(blocks, [&](size_t i) {
+            auto in = block(input, i);
+            auto slot = output.subspan(start + i * slot_size, e.max_encoded_size(in.size()));
+            size_t size = e.encode_into(in, slot);
+            if (size > slot.size())
+            {
+                spilled[i].resize(size);
+                size = e.encode_into(in, spilled[i]);
+            }
+            sizes[i] = size;
+        });
+
+        size_t total = start;
+        for (size_t i = 0; i < blocks; i++)
+            total += sizes[i];
+        bool any_spilled = std::any_of(spilled.begin(), spilled.end(), [](auto &b) { return !b.empty(); });
+        if (any_spilled && total > output.size())
+            return total;
+        // a spilled block can push the blocks after it past the start of a slot not yet moved, so stage them
+        byte_buffer staged;
+        if (any_spilled)
+        {
+            staged.resize(total - start);
+            for (size_t i = 0, pos = 0; i < blocks; pos += sizes[i], i++)
+                std::memcpy(staged.data() + pos,
+                            spilled[i].empty() ? output.data() + start + i * slot_size : spilled[i].data(), sizes[i]);
+        }
+
+        size_t header[3] = {input.size_bytes(), block_size, blocks};
+        std::memcpy(output.data(), header, sizeof(header));
+        size_t pos = 0;
+        for (size_t i = 0; i < blocks; i++)
+        {
+            std::memcpy(output.data() + (3 + i) * sizeof(size_t), &pos, sizeof(size_t));
+            if (!any_spilled)
+                std::memmove(output.data() + start + pos, output.data() + start + i * slot_size, sizes[i]);
+            pos += sizes[i];
+        }
+        std::memcpy(output.data() + (3 + blocks) * sizeof(size_t), &pos, sizeof(size_t));
+        if (any_spilled)
+            std::memcpy(output.data() + start, staged.data(), staged.size());
+        return total;
+    }
+    size_t decode_into(std::span<const std::byte> input, std::span<std::byte> output) override
+    {
+        size_t size = read(input, 0);
+        if (output.size() < size)
+            return size;
+        size_t stored_block_size = read(input, 1);
+        size_t blocks = read(input, 2);
+        if (stored_block_size == 0 || blocks != (size + stored_block_size - 1) / stored_block_size)
+            throw std::runtime_error("Corrupt chunked header");
+        size_t start = header_size(blocks);
+        if (read(input, 3 + blocks) > input.size() - start)
+            throw std::runtime_error("Truncated chunked input");
+        auto data = input.subspan(start);
+        ThreadPool::shared().run(blocks, [&](size_t i) {
+            size_t begin = read(input, 3 + i), end = read(input, 4 + i);
+            if (begin > end || end > data.size())
+                throw std::runtime_error("Corrupt chunked offsets");
+            size_t offset = i * stored_block_size;
+            size_t length = std::min(stored_block_size, size - offset);
+            if (e.decode_into(data.subspan(begin, end - begin), output.subspan(offset, length)) != length)
+                throw std::runtime_error("Chunked block decoded to the wrong size");
+        });
+        return size;
     }
 };
\ No newline at end of file
@@ -3,10 +3,13 @@
 // Licensed under the Apache 2.0 License.
 
 #include "util.hpp"
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
 #include <stdexcept>
+#include <type_traits>
 
 #define ALWAYS_INLINE __attribute__((__always_inline__))
 
@@ -14,304 +17,107 @@ typedef uint64_t UInt64;
 typedef uint32_t UInt32;
 typedef uint8_t UInt8;
 
-template <std::integral T> constexpr T byteswap(T value) noexcept
+// The bit stream is big-endian: the first bit of a value is the most significant bit of its first byte. Both sides
+// move whole unaligned 64-bit words instead of single bits. The writer stores a full word on every write, so its
+// output needs gorilla_slack bytes of room past the last byte holding data. The reader loads each value from its bit
+// position, at most 16 bytes, and switches to a zero padded copy for the end of its input.
+constexpr size_t gorilla_slack = 16;
+
+ALWAYS_INLINE inline UInt64 loadBigEndian64(const char *address)
 {
-    static_assert(std::has_unique_object_representations_v<T>, "T may not have padding bits");
-    auto value_representation = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
-    std::ranges::reverse(value_representation);
-    return std::bit_cast<T>(value_representation);
+    UInt64 value;
+    memcpy(&value, address, sizeof(value));
+    if constexpr (std::endian::native == std::endian::little)
+        value = __builtin_bswap64(value);
+    return value;
 }
 
-/** Returns a mask that has '1' for `bits` LSB set:
- * maskLowBits<UInt8>(3) => 00000111
- * maskLowBits<Int8>(3) => 00000111
- */
-template <typename T> inline T maskLowBits(unsigned char bits)
+ALWAYS_INLINE inline void storeBigEndian64(char *address, UInt64 value)
 {
-    using UnsignedT = std::make_unsigned_t<T>;
-    if (bits == 0)
-    {
-        return 0;
-    }
-
-    UnsignedT result = static_cast<UnsignedT>(~UnsignedT{0});
-    if (bits < sizeof(T) * 8)
-    {
-        result = static_cast<UnsignedT>(result >> (sizeof(UnsignedT) * 8 - bits));
-    }
-
-    return static_cast<T>(result);
+    if constexpr (std::endian::native == std::endian::little)
+        value = __builtin_bswap64(value);
+    memcpy(address, &value, sizeof(value));
 }
 
-class BitReader
+// the 64 bits of the stream starting at bit pos, reading the 16 bytes from byte pos / 8
+ALWAYS_INLINE inline UInt64 peekBits64(const char *data, UInt64 pos)
 {
-    const char *const source_begin;
-    const char *const source_end;
-    const char *source_current;
-
-    using BufferType = unsigned __int128;
-    BufferType bits_buffer = 0;
-
-    UInt8 bits_count = 0;
-
-  public:
-    BitReader(const char *begin, size_t size) : source_begin(begin), source_end(begin + size), source_current(begin)
-    {
-    }
-
-    ~BitReader() = default;
-
-    // reads bits_to_read high-bits from bits_buffer
-    ALWAYS_INLINE UInt64 readBits(UInt8 bits_to_read)
-    {
-        if (bits_to_read > bits_count)
-            fillBitBuffer();
-
-        return getBitsFromBitBuffer<CONSUME>(bits_to_read);
-    }
-
-    UInt8 peekByte()
-    {
-        if (bits_count < 8)
-            fillBitBuffer();
-
-        return getBitsFromBitBuffer<PEEK>(8);
-    }
-
-    ALWAYS_INLINE UInt8 readBit()
-    {
-        return static_cast<UInt8>(readBits(1));
-    }
-
-    // skip bits from bits_buffer
-    void skipBufferedBits(UInt8 bits)
-    {
-        bits_buffer <<= bits;
-        bits_count -= bits;
-    }
-
-    bool eof() const
-    {
-        return bits_count == 0 && source_current >= source_end;
-    }
-
-    // number of bits that was already read by clients with readBits()
-    UInt64 count() const
-    {
-        return (source_current - source_begin) * 8 - bits_count;
-    }
-
-    UInt64 remaining() const
-    {
-        return (source_end - source_current) * 8 + bits_count;
-    }
-
-  private:
-    enum GetBitsMode
-    {
-        CONSUME,
-        PEEK
-    };
-    // read data from internal buffer, if it has not enough bits, result is undefined.
-    template <GetBitsMode mode> UInt64 getBitsFromBitBuffer(UInt8 bits_to_read)
-    {
-        assert(bits_to_read > 0);
-
-        // push down the high-bits
-        const UInt64 result = static_cast<UInt64>(bits_buffer >> (sizeof(bits_buffer) * 8 - bits_to_read));
-
-        if constexpr (mode == CONSUME)
-        {
-            // 'erase' high-bits that were have read
-            skipBufferedBits(bits_to_read);
-        }
-
-        return result;
-    }
-
-    // Fills internal bits_buffer with data from source, reads at most 64 bits
-    ALWAYS_INLINE size_t fillBitBuffer()
-    {
-        const size_t available = source_end - source_current;
-        const auto bytes_to_read = std::min<size_t>(64 / 8, available);
-        if (available == 0)
-        {
-            if (bytes_to_read == 0)
-                return 0;
-
-            throw std::runtime_error(
-                string_format("Buffer is empty, but requested to read %d more bytes.", bytes_to_read));
-        }
-
-        UInt64 tmp_buffer = 0;
-        memcpy(&tmp_buffer, source_current, bytes_to_read);
-        source_current += bytes_to_read;
-
-        if constexpr (std::endian::native == std::endian::little)
-            tmp_buffer = byteswap(tmp_buffer);
+    const char *p = data + (pos >> 3);
+    const unsigned shift = pos & 7;
+    return (loadBigEndian64(p) << shift) | ((loadBigEndian64(p + 8) >> 1) >> (63 - shift));
+}
 
-        bits_buffer |= BufferType(tmp_buffer) << ((sizeof(BufferType) - sizeof(tmp_buffer)) * 8 - bits_count);
-        bits_count += static_cast<UInt8>(bytes_to_read) * 8;
+// at least the 57 bits of the stream starting at bit pos, from the 8 bytes at byte pos / 8
+ALWAYS_INLINE inline UInt64 peekBits57(const char *data, UInt64 pos)
+{
+    return loadBigEndian64(data + (pos >> 3)) << (pos & 7);
+}
 
-        return bytes_to_read;
-    }
-};
+// Runs decode(data, pos, limit), which decodes values while the bit position is below limit and returns the position
+// it stopped at, straight over the bytes at source and then over a zero padded copy of the last of them. decode may
+// load up to 32 bytes past the byte holding any position below limit. Returns the final bit position, which is past
+// bytes * 8 if the stream ran short.
+template <typename Decode> UInt64 decodeBitstream(const char *source, UInt64 bytes, Decode &&decode)
+{
+    UInt64 pos = 0;
+    if (bytes > 2 * gorilla_slack)
+        pos = decode(source, 0, (bytes - 2 * gorilla_slack) * 8);
+
+    // the rest is at most 32 bytes unless the input is corrupted
+    const UInt64 tail_start = std::min(pos >> 3, bytes);
+    char tail[5 * gorilla_slack] = {};
+    memcpy(tail, source + tail_start, std::min<UInt64>(bytes - tail_start, 2 * gorilla_slack));
+    return tail_start * 8 + decode(tail, pos - tail_start * 8, 3 * gorilla_slack * 8);
+}
 
-class BitWriter
+// Appends codes of up to 57 bits with one shift, one or and one word store each. Bits are held left aligned in acc and
+// the fewer than 8 that do not fill a byte stay there for the next write.
+class BitSink
 {
     char *dest_begin;
-    char *dest_end;
     char *dest_current;
-
-    using BufferType = unsigned __int128;
-    BufferType bits_buffer = 0;
-
-    UInt8 bits_count = 0;
-
-    static constexpr UInt8 BIT_BUFFER_SIZE = sizeof(bits_buffer) * 8;
+    UInt64 acc = 0;
+    unsigned pending = 0;
 
   public:
-    BitWriter(char *begin, size_t size) : dest_begin(begin), dest_end(begin + size), dest_current(begin)
-    {
-    }
-
-    ~BitWriter()
-    {
-        flush();
-    }
-
-    // write `bits_to_write` low-bits of `value` to the buffer
-    void writeBits(UInt8 bits_to_write, UInt64 value)
+    BitSink(char *begin) : dest_begin(begin), dest_current(begin)
     {
-        assert(bits_to_write > 0);
-
-        UInt32 capacity = BIT_BUFFER_SIZE - bits_count;
-        if (capacity < bits_to_write)
-        {
-            doFlush();
-            capacity = BIT_BUFFER_SIZE - bits_count;
-        }
-
-        // write low bits of value as high bits of bits_buffer
-        const UInt64 mask = maskLowBits<UInt64>(bits_to_write);
-        BufferType v = value & mask;
-        v <<= capacity - bits_to_write;
-
-        bits_buffer |= v;
-        bits_count += bits_to_write;
     }
 
-    // flush contents of bits_buffer to the dest_current, partial bytes are completed with zeroes.
-    void flush()
+    // writes the low len bits of code, which must be zero above them
+    ALWAYS_INLINE void write(UInt64 code, unsigned len)
     {
-        bits_count =
-            (bits_count + 8 - 1) & ~(8 - 1); // align up to 8-bytes, so doFlush will write all data from bits_buffer
-        while (bits_count != 0)
-            doFlush();
+        acc |= code << (64 - pending - len);
+        pending += len;
+        storeBigEndian64(dest_current, acc);
+        dest_current += pending >> 3;
+        acc <<= pending & ~7u;
+        pending &= 7;
     }
 
-    UInt64 count() const
+    // Writes header_bits of header, then data_bits of data taken from a value of bit_size bits. A 32-bit value with
+    // its header is one write. A 64-bit one can take more than 57 bits in all, so all but the low half of its data
+    // bits go with the header and the rest follow in a second write.
+    template <unsigned bit_size>
+    ALWAYS_INLINE void writeValue(UInt64 header, unsigned header_bits, UInt64 data, unsigned data_bits)
     {
-        return (dest_current - dest_begin) * 8 + bits_count;
-    }
-
-  private:
-    void doFlush()
-    {
-        // write whole bytes to the dest_current, leaving partial bits in bits_buffer
-        const size_t available = dest_end - dest_current;
-        const size_t to_write = std::min<size_t>(sizeof(UInt64), bits_count / 8); // align to 8-bit boundary
-
-        if (available < to_write)
+        if constexpr (bit_size <= 32)
+            write((header << data_bits) | data, header_bits + data_bits);
+        else
         {
-            throw std::runtime_error(string_format(
-                "Can not write past end of buffer. Space available is %d bytes, required to write %d bytes.", available,
-                to_write));
+            const unsigned low_bits = (data_bits + 1) / 2;
+            write((header << (data_bits - low_bits)) | (data >> low_bits), header_bits + data_bits - low_bits);
+            write(data & ((UInt64(1) << low_bits) - 1), low_bits);
         }
-
-        UInt64 tmp_buffer = static_cast<UInt64>(bits_buffer >> (sizeof(bits_buffer) - sizeof(UInt64)) * 8);
-        if constexpr (std::endian::native == std::endian::little)
-            tmp_buffer = byteswap(tmp_buffer);
-
-        memcpy(dest_current, &tmp_buffer, to_write);
-        dest_current += to_write;
-
-        bits_buffer <<= to_write * 8;
-        bits_count -= to_write * 8;
     }
-};
 
-// Unsafe since __builtin_ctz()-family explicitly state that result is undefined on x == 0
-template <typename T> inline size_t getTrailingZeroBitsUnsafe(T x)
-{
-    assert(x != 0);
-
-    if constexpr (sizeof(T) <= sizeof(unsigned int))
-    {
-        return __builtin_ctz(x);
-    }
-    else if constexpr (sizeof(T) <= sizeof(unsigned long int)) /// NOLINT
-    {
-        return __builtin_ctzl(x);
-    }
-    else
-    {
-        return __builtin_ctzll(x);
-    }
-}
-
-template <typename T> inline size_t getTrailingZeroBits(T x)
-{
-    if (!x)
-        return sizeof(x) * 8;
-
-    return getTrailingZeroBitsUnsafe(x);
-}
-
-template <typename T> inline uint32_t getLeadingZeroBitsUnsafe(T x)
-{
-    assert(x != 0);
-
-    if constexpr (sizeof(T) <= sizeof(unsigned int))
-    {
-        return __builtin_clz(x);
-    }
-    else if constexpr (sizeof(T) <= sizeof(unsigned long int)) /// NOLINT
-    {
-        return __builtin_clzl(x);
-    }
-    else
+    // bytes written, the last one padded with zero bits
+    size_t size() const
     {
-        return __builtin_clzll(x);
+        return (dest_current - dest_begin) + (pending + 7) / 8;
     }
-}
-
-template <typename T> inline size_t getLeadingZeroBits(T x)
-{
-    if (!x)
-        return sizeof(x) * 8;
-
-    return getLeadingZeroBitsUnsafe(x);
-}
-
-struct BinaryValueInfo
-{
-    UInt8 leading_zero_bits;
-    UInt8 data_bits;
-    UInt8 trailing_zero_bits;
 };
 
-template <typename T> BinaryValueInfo getBinaryValueInfo(const T &value)
-{
-    constexpr UInt8 bit_size = sizeof(T) * 8;
-
-    const UInt8 lz = getLeadingZeroBits(value);
-    const UInt8 tz = getTrailingZeroBits(value);
-    const UInt8 data_size = value == 0 ? 0 : static_cast<UInt8>(bit_size - lz - tz);
-
-    return {lz, data_size, tz};
-}
-
 inline void reverseMemcpy(void *dst, const void *src, size_t size)
 {
     uint8_t *uint_dst = reinterpret_cast<uint8_t *>(dst);
@@ -390,10 +196,11 @@ template <typename T> UInt32 compressDataForType(const char *source, UInt32 sour
     if (source_size % sizeof(T) != 0)
         throw std::runtime_error(string_format("Cannot compress with Gorilla codec, data size %d is not aligned to %d",
                                                source_size, sizeof(T)));
+    if (dest_size < sizeof(UInt32) + getCompressedDataSize<T>(source_size) + gorilla_slack)
+        throw std::runtime_error("Gorilla output buffer is too small");
 
     const char *const source_end = source + source_size;
     const char *const dest_start = dest;
-    const char *const dest_end = dest + dest_size;
 
     const UInt32 items_count = source_size / sizeof(T);
 
@@ -401,8 +208,6 @@ template <typename T> UInt32 compressDataForType(const char *source, UInt32 sour
     dest += sizeof(items_count);
 
     T prev_value = 0;
-    // That would cause first XORed value to be written in-full.
-    BinaryValueInfo prev_xored_info{0, 0, 0};
 
     if (source < source_end)
     {
@@ -413,46 +218,49 @@ template <typename T> UInt32 compressDataForType(const char *source, UInt32 sour
         dest += sizeof(prev_value);
     }
 
-    BitWriter writer(dest, dest_end - dest);
+    BitSink writer(dest);
 
-    static const auto DATA_BIT_LENGTH = getBitLengthOfLength(sizeof(T));
+    constexpr unsigned BIT_SIZE = sizeof(T) * 8;
+    constexpr unsigned DATA_BIT_LENGTH = getBitLengthOfLength(sizeof(T));
     // -1 since there must be at least 1 non-zero bit.
-    static const auto LEADING_ZEROES_BIT_LENGTH = DATA_BIT_LENGTH - 1;
+    constexpr unsigned LEADING_ZEROES_BIT_LENGTH = DATA_BIT_LENGTH - 1;
+
+    // That would cause first XORed value to be written in-full.
+    unsigned prev_leading = 0, prev_trailing = 0, prev_data_bits = 0;
 
     while (source < source_end)
     {
         const T curr_value = unalignedLoadLittleEndian<T>(source);
         source += sizeof(curr_value);
 
-        const auto xored_data = curr_value ^ prev_value;
-        const BinaryValueInfo curr_xored_info = getBinaryValueInfo(xored_data);
+        const T xored_data = curr_value ^ prev_value;
+        prev_value = curr_value;
+        const unsigned leading = std::countl_zero(xored_data);
+        const unsigned trailing = std::countr_zero(xored_data);
 
         if (xored_data == 0)
         {
-            writer.writeBits(1, 0);
+            writer.write(0, 1);
         }
-        else if (prev_xored_info.data_bits != 0 &&
-                 prev_xored_info.leading_zero_bits <= curr_xored_info.leading_zero_bits &&
-                 prev_xored_info.trailing_zero_bits <= curr_xored_info.trailing_zero_bits)
+        else if (prev_data_bits != 0 && prev_leading <= leading && prev_trailing <= trailing)
         {
-            writer.writeBits(2, 0b10);
-            writer.writeBits(prev_xored_info.data_bits, xored_data >> prev_xored_info.trailing_zero_bits);
+            // 0b10, then the bits inside the previous window
+            writer.writeValue<BIT_SIZE>(0b10, 2, xored_data >> prev_trailing, prev_data_bits);
         }
         else
         {
-            writer.writeBits(2, 0b11);
-            writer.writeBits(LEADING_ZEROES_BIT_LENGTH, curr_xored_info.leading_zero_bits);
-            writer.writeBits(DATA_BIT_LENGTH, curr_xored_info.data_bits);
-            writer.writeBits(curr_xored_info.data_bits, xored_data >> curr_xored_info.trailing_zero_bits);
-            prev_xored_info = curr_xored_info;
+            // 0b11, the leading zeroes, the data bit count and the data bits
+            const unsigned data_bits = BIT_SIZE - leading - trailing;
+            const UInt64 header = (((0b11u << LEADING_ZEROES_BIT_LENGTH) | leading) << DATA_BIT_LENGTH) | data_bits;
+            writer.writeValue<BIT_SIZE>(header, 2 + LEADING_ZEROES_BIT_LENGTH + DATA_BIT_LENGTH, xored_data >> trailing,
+                                        data_bits);
+            prev_leading = leading;
+            prev_trailing = trailing;
+            prev_data_bits = data_bits;
         }
-
-        prev_value = curr_value;
     }
 
-    writer.flush();
-
-    return static_cast<UInt32>((dest - dest_start) + (writer.count() + 7) / 8);
+    return static_cast<UInt32>((dest - dest_start) + writer.size());
 }
 
 template <typename T> void decompressDataForType(const char *source, UInt32 source_size, char *dest, UInt32 dest_size)
@@ -480,50 +288,69 @@ template <typename T> void decompressDataForType(const char *source, UInt32 sour
     source += sizeof(prev_value);
     dest += sizeof(prev_value);
 
-    BitReader reader(source, source_size - sizeof(items_count) - sizeof(prev_value));
-
-    BinaryValueInfo prev_xored_info{0, 0, 0};
-
-    static const auto DATA_BIT_LENGTH = getBitLengthOfLength(sizeof(T));
+    constexpr unsigned BIT_SIZE = sizeof(T) * 8;
+    constexpr unsigned DATA_BIT_LENGTH = getBitLengthOfLength(sizeof(T));
     // -1 since there must be at least 1 non-zero bit.
-    static const auto LEADING_ZEROES_BIT_LENGTH = DATA_BIT_LENGTH - 1;
-
-    // since data is tightly packed, up to 1 bit per value, and last byte is padded with zeroes,
-    // we have to keep track of items to avoid reading more that there is.
-    for (UInt32 items_read = 1; items_read < items_count && !reader.eof(); ++items_read)
+    constexpr unsigned LEADING_ZEROES_BIT_LENGTH = DATA_BIT_LENGTH - 1;
+    constexpr unsigned NEW_HEADER_BITS = 2 + LEADING_ZEROES_BIT_LENGTH + DATA_BIT_LENGTH;
+
+    unsigned leading = 0, data_bits = 0;
+    bool corrupted = false;
+    UInt32 items_read = 1;
+
+    // Decodes values while the bit position is below limit, each from a window of the stream loaded at its position, so
+    // no bit buffer has to be kept or refilled. The control prefix selects the path: when it is predictable, as in
+    // most real data, the position of the next value does not wait for the load. Headers that cannot come from the
+    // encoder are only noted, and reported after the loop.
+    auto decode = [&](const char *data, UInt64 pos, UInt64 limit) ALWAYS_INLINE
     {
-        T curr_value = prev_value;
-        BinaryValueInfo curr_xored_info = prev_xored_info;
-        T xored_data = 0;
-
-        if (reader.readBit() == 1)
+        // locals, since the stores through dest could otherwise alias the captured state
+        T prev = prev_value;
+        unsigned lz = leading, db = data_bits;
+        bool bad = false;
+        char *out = dest;
+        char *const out_end = dest + static_cast<UInt64>(items_count - items_read) * sizeof(T);
+        for (; out < out_end && pos < limit; out += sizeof(T))
         {
-            if (reader.readBit() == 1)
+            UInt64 window = peekBits57(data, pos);
+            if (window >> 63)
             {
-                // 0b11 prefix
-                curr_xored_info.leading_zero_bits = reader.readBits(LEADING_ZEROES_BIT_LENGTH);
-                curr_xored_info.data_bits = reader.readBits(DATA_BIT_LENGTH);
-                curr_xored_info.trailing_zero_bits =
-                    sizeof(T) * 8 - curr_xored_info.leading_zero_bits - curr_xored_info.data_bits;
+                if (window >> 62 == 0b11)
+                {
+                    lz = (window >> (62 - LEADING_ZEROES_BIT_LENGTH)) & ((1u << LEADING_ZEROES_BIT_LENGTH) - 1);
+                    db = (window >> (62 - LEADING_ZEROES_BIT_LENGTH - DATA_BIT_LENGTH)) & ((1u << DATA_BIT_LENGTH) - 1);
+                    bad |= (db == 0) | (lz + db > BIT_SIZE);
+                    pos += NEW_HEADER_BITS;
+                    window <<= NEW_HEADER_BITS;
+                }
+                else
+                {
+                    bad |= db == 0;
+                    pos += 2;
+                    window <<= 2;
+                }
+                if constexpr (sizeof(T) == 8)
+                    window = peekBits64(data, pos);
+                // a zero db was noted above, the shift is only kept in range for it
+                const UInt64 payload = (window >> ((64 - db) & 63)) & -UInt64(db != 0);
+                prev ^= static_cast<T>(payload) << ((BIT_SIZE - lz - db) & (BIT_SIZE - 1));
+                pos += db;
             }
-            // else: 0b10 prefix - use prev_xored_info
-
-            if (curr_xored_info.leading_zero_bits == 0 && curr_xored_info.data_bits == 0 &&
-                curr_xored_info.trailing_zero_bits == 0) [[unlikely]]
-            {
-                throw std::runtime_error("Cannot decompress Gorilla-encoded data: corrupted input data.");
-            }
-
-            xored_data = static_cast<T>(reader.readBits(curr_xored_info.data_bits));
-            xored_data <<= curr_xored_info.trailing_zero_bits;
-            curr_value = prev_value ^ xored_data;
+            else
+                ++pos;
+            unalignedStoreLittleEndian<T>(out, prev);
         }
-        // else: 0b0 prefix - use prev_value
-
-        unalignedStoreLittleEndian<T>(dest, curr_value);
-        dest += sizeof(curr_value);
+        prev_value = prev;
+        leading = lz;
+        data_bits = db;
+        corrupted |= bad;
+        items_read += (out - dest) / sizeof(T);
+        dest = out;
+        return pos;
+    };
 
-        prev_xored_info = curr_xored_info;
-        prev_value = curr_value;
-    }
+    const UInt64 bytes = source_end - source;
+    const UInt64 pos = decodeBitstream(source, bytes, decode);
+    if (corrupted || items_read < items_count || pos > bytes * 8)
+        throw std::runtime_error("Cannot decompress Gorilla-encoded data: corrupted input data.");
 }
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct bench_result_ex;
+
+struct matrix_dataset
+{
+    std::string name;
+    std::vector<double> error_bounds;
+    std::vector<std::string> methods;
+};
+
+struct matrix_entry
+{
+    size_t index;
+    size_t dataset;
+    double error_bound;
+    size_t method;
+};
+
+// Deterministic enumeration of every dataset x error bound x method combination. Machines that build the matrix
+// from the same inputs agree on every index, so each can run its own shard without coordinating.
+class BenchmarkMatrix
+{
+    std::vector<matrix_dataset> datasets;
+    std::vector<matrix_entry> entries;
+    std::string matrix_id;
+
+  public:
+    BenchmarkMatrix(std::vector<matrix_dataset> datasets);
+    size_t size() const
+    {
+        return entries.size();
+    }
+    // fingerprint of the full matrix, used to check that shards belong together
+    const std::string &id() const
+    {
+        return matrix_id;
+    }
+    const matrix_dataset &dataset(size_t i) const
+    {
+        return datasets[i];
+    }
+    // entries of shard k (1-based) of n, assigned round robin so expensive methods are spread across shards
+    std::vector<matrix_entry> shard(size_t k, size_t n) const;
+};
+
+// Combines the results of every shard of one matrix into a single list ordered by matrix index. Throws if shards
+// are missing, duplicated or were produced from different matrices.
+std::vector<bench_result_ex> merge_shards(std::vector<std::vector<bench_result_ex>> shards);
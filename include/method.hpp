@@ -1,5 +1,7 @@
 #pragma once
+#include "arena.hpp"
 #include "encoding.hpp"
+#include "streams.hpp"
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -7,6 +9,8 @@
 #include <string>
 #include <vector>
 
+// A Method keeps the result of its last compress() for decompress(), so concurrent callers each need their own. The
+// Encodings that Methods share are thread safe.
 template <typename F> class Method
 {
   protected:
@@ -16,6 +20,12 @@ template <typename F> class Method
     virtual std::string name() = 0;
     virtual size_t compress(std::span<const F> input) = 0;
     virtual std::span<const F> decompress() = 0;
+    // decompresses straight into output, which must have room for every compressed value; returns the count written
+    virtual size_t decompress_into(std::span<F> output) = 0;
+    // the bytes produced by the last call to compress()
+    virtual std::span<const std::byte> compressed() = 0;
+    // replaces the bytes decompress() works from, they must stay alive until then
+    virtual void load(std::span<const std::byte> data) = 0;
     virtual ~Method(){};
     void set_error_bound(F error)
     {
@@ -36,6 +46,15 @@ template <typename F> class Lossless : public Method<F>
     };
     size_t compress(const std::span<const F> input) override;
     std::span<const F> decompress() override;
+    size_t decompress_into(std::span<F> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return compressed_span;
+    }
+    void load(std::span<const std::byte> data) override
+    {
+        compressed_span = data;
+    }
 };
 
 template <typename F> class Sz3 : public Method<F>
@@ -44,6 +63,7 @@ template <typename F> class Sz3 : public Method<F>
     size_t compressed_size;
     std::unique_ptr<F[]> decompressed_data;
     size_t decompressed_size;
+    size_t input_size = 0; // like Machete, only known from the last compress()
 
   public:
     std::string name() override
@@ -52,15 +72,27 @@ template <typename F> class Sz3 : public Method<F>
     };
     size_t compress(std::span<const F> input) override;
     std::span<const F> decompress() override;
+    size_t decompress_into(std::span<F> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return std::as_bytes(std::span(compressed_data.get(), compressed_size));
+    }
+    void load(std::span<const std::byte> data) override;
 };
 
 template <typename F, bool split, int stride, bool encode = false> class Lfzip : public Method<F>
 {
     static constexpr size_t filter_size = 32;
     std::span<const std::byte> compressed_span;
-    std::vector<F> result;
+    pooled_vector<F> result;
+    Arena arena; // per-call intermediates
     std::shared_ptr<Encoding> encoding;
 
+    PackedStreams<2> pack(std::span<const F> outliers, std::span<const int16_t> indices);
+    // the index stream is left byte split in the split variants, reconstruct un-splits it tile by tile
+    void decode_streams(std::span<const F> &outliers, std::span<const std::byte> &indices);
+    void reconstruct(std::span<const F> outliers, std::span<const std::byte> indices, std::span<F> output);
+
   public:
     Lfzip(std::shared_ptr<Encoding> e) : encoding(e){};
     std::string name() override
@@ -82,14 +114,29 @@ template <typename F, bool split, int stride, bool encode = false> class Lfzip :
     };
     size_t compress(std::span<const F> input) override;
     std::span<const F> decompress() override;
+    size_t decompress_into(std::span<F> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return compressed_span;
+    }
+    void load(std::span<const std::byte> data) override
+    {
+        compressed_span = data;
+    }
 };
 
 template <typename F, bool split, bool encode = false> class Quantise : public Method<F>
 {
     std::span<const std::byte> compressed_span;
-    std::vector<F> result;
+    pooled_vector<F> result;
+    Arena arena; // per-call intermediates
     std::shared_ptr<Encoding> encoding;
 
+    PackedStreams<2> pack(std::span<const F> outliers, std::span<const int16_t> indices);
+    // as in Lfzip, split index streams are only un-split a tile at a time during reconstruct
+    void decode_streams(std::span<const F> &outliers, std::span<const std::byte> &indices);
+    void reconstruct(std::span<const F> outliers, std::span<const std::byte> indices, std::span<F> output);
+
   public:
     Quantise(std::shared_ptr<Encoding> e) : encoding(e){};
     std::string name() override
@@ -107,6 +154,15 @@ template <typename F, bool split, bool encode = false> class Quantise : public M
     };
     size_t compress(std::span<const F> input) override;
     std::span<const F> decompress() override;
+    size_t decompress_into(std::span<F> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return compressed_span;
+    }
+    void load(std::span<const std::byte> data) override
+    {
+        compressed_span = data;
+    }
 };
 
 class Machete : public Method<double>
@@ -114,7 +170,7 @@ class Machete : public Method<double>
     size_t in_sz = 0; // sort of cheating compared to the other methods.
     size_t out_sz = 0;
     uint8_t *compressed_buffer = nullptr;
-    std::vector<double> results;
+    pooled_vector<double> results;
 
     void free_data()
     {
@@ -134,6 +190,12 @@ class Machete : public Method<double>
     };
     size_t compress(std::span<const double> input) override;
     std::span<const double> decompress() override;
+    size_t decompress_into(std::span<double> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return std::as_bytes(std::span(compressed_buffer, out_sz));
+    }
+    void load(std::span<const std::byte> data) override;
     ~Machete()
     {
         free_data();
@@ -153,6 +215,15 @@ template <typename F> class Mask : public Method<F>
     };
     size_t compress(std::span<const F> input) override;
     std::span<const F> decompress() override;
+    size_t decompress_into(std::span<F> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return compressed_span;
+    }
+    void load(std::span<const std::byte> data) override
+    {
+        compressed_span = data;
+    }
 };
 
 template <typename F> class IntFloat : public Method<F>
@@ -160,7 +231,7 @@ template <typename F> class IntFloat : public Method<F>
     std::span<const std::byte> compressed_span;
     std::shared_ptr<Encoding> encoding;
 
-    std::unique_ptr<F[]> results;
+    pooled_array<F> results;
 
   public:
     IntFloat(std::shared_ptr<Encoding> e) : encoding(e){};
@@ -170,12 +241,23 @@ template <typename F> class IntFloat : public Method<F>
     };
     size_t compress(std::span<const F> input) override;
     std::span<const F> decompress() override;
+    size_t decompress_into(std::span<F> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return compressed_span;
+    }
+    void load(std::span<const std::byte> data) override
+    {
+        compressed_span = data;
+    }
 };
 
 template <typename F> class Zfp : public Method<F>
 {
-    std::vector<std::byte> compressed_buffer;
-    std::vector<F> results;
+    byte_buffer compressed_buffer;
+    pooled_vector<F> results;
+
+    size_t decompressed_count();
 
   public:
     std::string name() override
@@ -184,4 +266,13 @@ template <typename F> class Zfp : public Method<F>
     };
     size_t compress(std::span<const F> input) override;
     std::span<const F> decompress() override;
+    size_t decompress_into(std::span<F> output) override;
+    std::span<const std::byte> compressed() override
+    {
+        return compressed_buffer;
+    }
+    void load(std::span<const std::byte> data) override
+    {
+        compressed_buffer.assign(data.begin(), data.end());
+    }
 };
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+// Characteristics of an input array that help explain why one pipeline beats another on it.
+struct data_profile
+{
+    size_t count = 0;
+    size_t nan_count = 0;
+    size_t inf_count = 0;
+    // the remaining statistics only consider finite values
+    double min = 0;
+    double max = 0;
+    double lag1_autocorrelation = 0;
+    double mean_abs_diff1 = 0; // mean |x[i] - x[i-1]|
+    double mean_abs_diff2 = 0; // mean |x[i] - 2x[i-1] + x[i-2]|
+    double repeated_fraction = 0; // fraction of values bitwise equal to their predecessor
+    double cardinality = 0;       // estimated number of distinct bit patterns
+    // Shannon entropy in bits of each byte plane, least significant first, the same planes Stream Split produces.
+    std::vector<double> byte_entropy;
+
+    std::string byte_entropy_string() const;
+};
+
+// Profiles data in one pass split across threads, 0 uses every hardware thread.
+template <typename F> data_profile profile_data(std::span<const F> data, size_t threads = 0);
@@ -0,0 +1,7 @@
+#pragma once
+#include <iosfwd>
+
+// Round trips the floating point encodings (Gorilla, Chimp, Chimp128, ALP, FPC) for float and double over edge cases
+// (empty and odd length arrays, NaN payloads, -0, infinities, subnormals, random bits) and over decimal and smooth
+// data, and checks the output bit for bit. Failures are reported to out; the return value is the number of them.
+int self_test(std::ostream &out);
\ No newline at end of file
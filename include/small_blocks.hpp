@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+
+class Encoding;
+
+struct small_block_result
+{
+    std::string name;
+    size_t block_size;
+    size_t block_count;
+    size_t original_size;
+    size_t compressed_size;
+    double compression_time;
+    double decompression_time;
+
+    double mbytes()
+    {
+        return (double)(original_size) / (1024.0l * 1024.0l);
+    };
+    double compression_data_rate()
+    {
+        return mbytes() / compression_time;
+    }
+    double decompression_data_rate()
+    {
+        return mbytes() / decompression_time;
+    }
+};
+
+// Encodes every whole block_size block of data as a message of its own, the way a stream of small telemetry records
+// would be sent, then decodes each one and checks it. A partial last block is left out.
+small_block_result benchmark_small_blocks(std::span<const std::byte> data, size_t block_size, Encoding &encoding);
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+
+template <typename F> class Method;
+
+struct storage_options
+{
+    std::string directory;
+    bool direct = false; // O_DIRECT reads and writes
+    bool fsync = false;  // include fsync in the write time
+    bool drop_cache = true;
+};
+
+struct storage_result
+{
+    std::string name;
+    size_t original_size;
+    size_t compressed_size;
+    double compression_time;
+    double write_time;
+    double read_time;
+    double decompression_time;
+    bool cache_dropped;
+
+    double mbytes()
+    {
+        return (double)(original_size) / (1024.0l * 1024.0l);
+    };
+    // rates are in uncompressed MB/s so they compare directly with writing the raw array
+    double write_data_rate()
+    {
+        return mbytes() / (compression_time + write_time);
+    }
+    double read_data_rate()
+    {
+        return mbytes() / (read_time + decompression_time);
+    }
+};
+
+template <typename F> storage_result benchmark_storage_raw(std::span<const F> original_buffer, storage_options options);
+
+template <typename F>
+storage_result benchmark_storage(std::span<const F> original_buffer, Method<F> &method, F error_bound,
+                                 storage_options options);
@@ -0,0 +1,119 @@
+#pragma once
+#include "arena.hpp"
+#include "encoding.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+// Several typed streams laid out as one byte stream: [stream count][size in bytes of every stream], then every stream
+// starting at a multiple of stream_alignment bytes, zero padded in between. The streams are not copied; segments()
+// lists the pieces of the layout for Encoding::encode_segments, which reads them in place. Decoded into a buffer that
+// is itself aligned, every stream lands on an aligned address.
+constexpr size_t stream_alignment = 64;
+
+template <size_t N> class PackedStreams
+{
+    std::array<size_t, N + 1> header;
+    std::array<std::span<const std::byte>, N> streams;
+
+    static std::span<const std::byte> padding(size_t offset)
+    {
+        alignas(stream_alignment) static const std::byte zeros[stream_alignment] = {};
+        return std::span<const std::byte>(zeros, (stream_alignment - offset % stream_alignment) % stream_alignment);
+    }
+
+  public:
+    template <typename... Types>
+    explicit PackedStreams(std::span<Types>... spans)
+        : header{N, spans.size_bytes()...}, streams{std::as_bytes(spans)...}
+    {
+        static_assert(sizeof...(Types) == N);
+    }
+
+    // header, then padding and stream in turn; only valid while this object is
+    std::array<std::span<const std::byte>, 2 * N + 1> segments() const
+    {
+        std::array<std::span<const std::byte>, 2 * N + 1> parts;
+        parts[0] = std::as_bytes(std::span(header));
+        size_t offset = parts[0].size();
+        for (size_t i = 0; i < N; i++)
+        {
+            parts[2 * i + 1] = padding(offset);
+            parts[2 * i + 2] = streams[i];
+            offset += parts[2 * i + 1].size() + streams[i].size();
+        }
+        return parts;
+    }
+};
+
+template <typename... Types> PackedStreams(std::span<Types>...) -> PackedStreams<sizeof...(Types)>;
+
+template <typename... Types> void _do_unpack_streams(std::span<const std::byte> data, size_t, size_t offset)
+{
+    if (offset != data.size())
+        throw std::runtime_error("bad unpacking");
+}
+
+template <typename Type, typename... Types>
+void _do_unpack_streams(std::span<const std::byte> data, size_t index, size_t offset, std::span<const Type> &span,
+                        std::span<const Types> &...spans)
+{
+    size_t size;
+    std::memcpy(&size, data.data() + (index + 1) * sizeof(size_t), sizeof(size_t));
+    offset = (offset + stream_alignment - 1) / stream_alignment * stream_alignment;
+    if (size % sizeof(Type) != 0 || offset > data.size() || size > data.size() - offset)
+        throw std::runtime_error("bad unpacking");
+    span = std::span<const Type>(reinterpret_cast<const Type *>(data.data() + offset), size / sizeof(Type));
+    _do_unpack_streams(data, index + 1, offset + size, spans...);
+}
+
+// Finds the streams of a PackedStreams layout in data. If data is not aligned (some codecs decode into their own
+// allocation) it is copied into the arena first, so the streams are always aligned.
+template <typename... Types>
+void unpack_streams(std::span<const std::byte> data, Arena &arena, std::span<const Types> &...spans)
+{
+    constexpr size_t N = sizeof...(Types);
+    size_t count;
+    if (data.size() < (N + 1) * sizeof(size_t))
+        throw std::runtime_error("bad unpacking");
+    std::memcpy(&count, data.data(), sizeof(size_t));
+    if (count != N)
+        throw std::runtime_error("bad unpacking: expected " + std::to_string(N) + " streams, found " +
+                                 std::to_string(count));
+    if (reinterpret_cast<uintptr_t>(data.data()) % stream_alignment != 0)
+    {
+        auto copy = arena.allocate<std::byte>(data.size());
+        std::memcpy(copy.data(), data.data(), data.size());
+        data = copy;
+    }
+    _do_unpack_streams(data, 0, (N + 1) * sizeof(size_t), spans...);
+}
+
+// Calls fn(first, indices) for consecutive tiles of a stream of int16 indices. A byte split stream is un-split one
+// small tile at a time, so the full index array is never materialised.
+template <bool split, typename Fn> void for_each_index_tile(std::span<const std::byte> stream, Fn fn)
+{
+    if (stream.size() % sizeof(int16_t) != 0)
+        throw std::runtime_error("bad unpacking");
+    size_t count = stream.size() / sizeof(int16_t);
+    if constexpr (split)
+    {
+        constexpr size_t tile_size = 4096;
+        alignas(stream_alignment) int16_t tile[tile_size];
+        for (size_t first = 0; first < count; first += tile_size)
+        {
+            std::span<int16_t> indices(tile, std::min(tile_size, count - first));
+            streamsplit_dec_range<uint16_t>(stream, first, std::as_writable_bytes(indices));
+            fn(first, std::span<const int16_t>(indices));
+        }
+    }
+    else
+    {
+        fn(size_t(0), std::span<const int16_t>(reinterpret_cast<const int16_t *>(stream.data()), count));
+    }
+}
\ No newline at end of file
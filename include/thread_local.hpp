@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// A separate T for every thread that uses this object, for scratch state that would otherwise make a shared object
+// unsafe to call concurrently. get() finds the calling thread's instance without locking; only creating it on a
+// thread's first call, and destroying it when that thread exits, take the lock. Instances left by threads that are
+// still running are destroyed with the ThreadLocal, and those threads drop their handles on it when they next create
+// an instance of any ThreadLocal.
+template <typename T> class ThreadLocal
+{
+    struct registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<T>> instances;
+    };
+
+    // a thread's handle on one instance, which hands the instance back when the thread exits
+    struct thread_entry
+    {
+        T *instance;
+        std::weak_ptr<registry> owner;
+
+        thread_entry(T *instance, std::weak_ptr<registry> owner) : instance(instance), owner(owner)
+        {
+        }
+        thread_entry(const thread_entry &) = delete;
+        ~thread_entry()
+        {
+            if (auto r = owner.lock())
+            {
+                std::lock_guard<std::mutex> lock(r->mutex);
+                auto it = std::find_if(r->instances.begin(), r->instances.end(),
+                                       [&](const std::unique_ptr<T> &p) { return p.get() == instance; });
+                if (it != r->instances.end())
+                    r->instances.erase(it);
+            }
+        }
+    };
+
+    static inline std::atomic<uint64_t> next_id = 1;
+    // ids are never reused, so entries for destroyed objects are never looked up again
+    uint64_t id = next_id++;
+    std::shared_ptr<registry> reg = std::make_shared<registry>();
+
+    static std::unordered_map<uint64_t, thread_entry> &thread_entries()
+    {
+        thread_local std::unordered_map<uint64_t, thread_entry> entries;
+        return entries;
+    }
+
+  public:
+    ThreadLocal() = default;
+    ThreadLocal(const ThreadLocal &) = delete;
+    ThreadLocal &operator=(const ThreadLocal &) = delete;
+
+    T &get()
+    {
+        auto &entries = thread_entries();
+        auto it = entries.find(id);
+        if (it != entries.end())
+            return *it->second.instance;
+        T *instance;
+        {
+            std::lock_guard<std::mutex> lock(reg->mutex);
+            instance = reg->instances.emplace_back(std::make_unique<T>()).get();
+        }
+        // drop handles on ThreadLocals destroyed since this thread last got here, so the map only holds live ones
+        std::erase_if(entries, [](const auto &entry) { return entry.second.owner.expired(); });
+        entries.try_emplace(id, instance, reg);
+        return *instance;
+    }
+};
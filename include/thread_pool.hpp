@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by everything that runs in parallel. run() splits the index range evenly between
+// its participants; each works through its own share from the front and, once that is empty, steals the back half of
+// another participant's share, so uneven work items still keep every thread busy. The calling thread always takes
+// part, which makes nested run() calls from inside a task safe.
+class ThreadPool
+{
+    struct job
+    {
+        struct share
+        {
+            std::mutex mutex;
+            size_t begin = 0;
+            size_t end = 0;
+        };
+
+        std::function<void(size_t)> fn;
+        std::vector<share> shares; // one per participant, shares[0] belongs to the caller
+        size_t claimed = 1;        // participants so far, guarded by the pool mutex
+        std::atomic<size_t> pending;
+        std::atomic<bool> failed = false;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+
+        job(std::function<void(size_t)> fn, size_t n, size_t participants);
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<job>> jobs;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void worker_loop();
+    void run_job(std::function<void(size_t)> fn, size_t n, size_t max_threads);
+    static bool take(job &j, size_t slot, size_t &index);
+    static void work(job &j, size_t slot);
+
+  public:
+    explicit ThreadPool(size_t threads);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    // threads that can work on one run() call, including the caller
+    size_t size() const
+    {
+        return workers.size() + 1;
+    }
+
+    // Calls fn(i) for every i in [0, n) on up to max_threads threads and returns once all calls have finished. The
+    // first exception thrown by fn is rethrown; indices not yet started when it was thrown are skipped.
+    template <typename Fn> void run(size_t n, Fn fn, size_t max_threads = SIZE_MAX)
+    {
+        if (std::min({n, max_threads, size()}) <= 1)
+        {
+            for (size_t i = 0; i < n; i++)
+                fn(i);
+            return;
+        }
+        run_job(std::function<void(size_t)>(std::move(fn)), n, max_threads);
+    }
+
+    // one worker per hardware thread besides the caller
+    static ThreadPool &shared();
+};
+
+// Libraries with threads of their own (zstd workers, libbsc's OpenMP) may start this many for one call: the cores
+// divided between the benchmark jobs that run at once, which main sets from --jobs.
+void set_concurrent_jobs(size_t jobs);
+size_t threads_per_job();
+
+// Calls fn(i) for every i in [0, n) on up to `threads` threads of the shared pool. The first exception thrown by fn is
+// rethrown once every thread has stopped.
+template <typename Fn> void parallel_for(size_t n, size_t threads, Fn fn)
+{
+    ThreadPool::shared().run(n, std::move(fn), threads);
+}
\ No newline at end of file
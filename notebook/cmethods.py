@@ -37,29 +37,45 @@ lib.reconstruct.argtypes = [
     ctypes.c_double,
 ]
 lib.reconstruct.restype = ctypes.c_int
+lib.reconstruct_into.argtypes = [
+    ctypes.POINTER(bench_result),
+    ctypes.c_char_p,
+    ctypes.c_char,
+    ctypes.c_void_p,
+    ctypes.c_void_p,
+    ctypes.c_size_t,
+    ctypes.c_double,
+]
+lib.reconstruct_into.restype = ctypes.c_int
 
 
-def reconstruct(method_name: str, array: np.ndarray, error_bound: float):
+def reconstruct(method_name: str, array: np.ndarray, error_bound: float, out=None):
+    """Compress and decompress array, writing the reconstruction into out (which may be array itself)."""
     if array.dtype == np.float32:
         dtype_char = ord("f")
     elif array.dtype == np.float64:
         dtype_char = ord("d")
     else:
         raise Exception("Unsupported data type")
-    buf = array.tobytes()
+    array = np.ascontiguousarray(array)
+    if out is None:
+        out = np.empty_like(array)
+    elif out.dtype != array.dtype or out.size != array.size or not out.flags.c_contiguous or not out.flags.writeable:
+        raise Exception("out must be a writeable contiguous array matching the input")
     results = bench_result()
-    ret = lib.reconstruct(
+    ret = lib.reconstruct_into(
         ctypes.byref(results),
         ctypes.create_string_buffer(method_name.encode("ascii")),
         dtype_char,
-        buf,
+        array.ctypes.data,
+        out.ctypes.data,
         array.size,
         error_bound
     )
     if ret != 0:
         raise Exception("Reconstruct failed")
     return (
-        np.frombuffer(buf, dtype=array.dtype),
+        out,
         results.compressed_size,
         results.compression_time,
         results.decompression_time,
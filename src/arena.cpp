@@ -0,0 +1,33 @@
+#include "arena.hpp"
+#include <cstddef>
+
+static size_t round_up(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+std::byte *Arena::allocate_bytes(size_t size)
+{
+    size = round_up(size, alignment);
+    if (used + size <= block.size())
+    {
+        std::byte *ptr = block.get() + used;
+        used += size;
+        return ptr;
+    }
+    overflow.emplace_back(size);
+    overflow_size += size;
+    return overflow.back().get();
+}
+
+void Arena::reset()
+{
+    size_t high_water = used + overflow_size;
+    if (high_water > block.size())
+    {
+        block = pooled_array<std::byte>(high_water);
+    }
+    overflow.clear();
+    overflow_size = 0;
+    used = 0;
+}
\ No newline at end of file
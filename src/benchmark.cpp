@@ -1,14 +1,18 @@
 #include "benchmark.hpp"
 #include "method.hpp"
+#include "util.hpp"
 #include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cmath>
 #include <cstddef>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <ostream>
 #include <random>
 #include <sstream>
+#include <stdexcept>
 
 template <typename F> std::vector<F> generate_random_data(size_t size, double lower, double upper, bool seed)
 {
@@ -65,8 +69,22 @@ bench_result_ex benchmark(std::span<const F> original_buffer, Method<F> &method,
         std::cout << "done" << std::endl << "Decompressing... ";
         std::cout.flush();
     }
+    // reconstruct straight into the caller's buffer when there is one, it may alias original_buffer
+    bool into_output = output_buffer.size() == original_buffer.size();
+    if (into_output && !skip_metrics && output_buffer.data() == original_buffer.data())
+    {
+        throw std::runtime_error("Cannot measure error when reconstructing in place");
+    }
+    std::span<const F> decompressed;
     tstart = std::chrono::high_resolution_clock::now();
-    auto decompressed = method.decompress();
+    if (into_output)
+    {
+        decompressed = output_buffer.first(method.decompress_into(output_buffer));
+    }
+    else
+    {
+        decompressed = method.decompress();
+    }
     tend = std::chrono::high_resolution_clock::now();
     auto decompress_duration = std::chrono::duration<double>(tend - tstart);
     if (!quiet)
@@ -107,6 +125,7 @@ bench_result_ex benchmark(std::span<const F> original_buffer, Method<F> &method,
 
     bench_result_ex b;
     b.name = method.name();
+    b.error_bound = error_bound;
     b.original_size = original_buffer.size() * sizeof(original_buffer[0]);
     b.compressed_size = compressed_sz;
     b.compression_time = compress_duration.count();
@@ -119,11 +138,6 @@ bench_result_ex benchmark(std::span<const F> original_buffer, Method<F> &method,
         std::cout.flush();
     }
 
-    if (decompressed.size() == output_buffer.size())
-    {
-        std::copy(decompressed.begin(), decompressed.end(), output_buffer.begin());
-    }
-
     return b;
 }
 template bench_result_ex benchmark(std::span<const float> original_buffer, Method<float> &method, float error_bound,
@@ -140,4 +154,138 @@ bench_result &bench_result::operator=(const bench_result_ex &other)
     max_error = other.max_error;
     mean_absolute_error = other.mean_absolute_error;
     return *this;
-}
\ No newline at end of file
+}
+static const std::vector<std::string> result_columns = {"name",
+                                                         "original_size",
+                                                         "compressed_size",
+                                                         "compression_time",
+                                                         "decompression_time",
+                                                         "max_error",
+                                                         "mean_absolute_error"};
+// written by newer builds, optional when reading
+static const std::vector<std::string> matrix_columns = {"dataset",      "error_bound", "matrix_id",
+                                                        "matrix_index", "matrix_size", "shard"};
+static const std::vector<std::string> profile_columns = {
+    "count",          "nan_count",      "inf_count",         "min",         "max",         "lag1_autocorrelation",
+    "mean_abs_diff1", "mean_abs_diff2", "repeated_fraction", "cardinality", "byte_entropy"};
+
+bool csv_field_ok(const std::string &field)
+{
+    return field.find_first_of(",\n") == std::string::npos;
+}
+
+void results_to_file(std::string path, std::vector<bench_result_ex> &results)
+{
+    // checked before the file is opened, so a bad row does not leave a truncated file behind
+    for (bench_result_ex &r : results)
+        if (!csv_field_ok(r.name) || !csv_field_ok(r.dataset))
+            throw std::runtime_error("result for \"" + r.name + "\" on \"" + r.dataset + "\" cannot be written to csv");
+    std::ofstream csv(path);
+    if (!csv.is_open())
+        throw std::runtime_error("cannot open file");
+    for (size_t i = 0; i < result_columns.size(); i++)
+        csv << (i ? ", " : "") << result_columns[i];
+    for (auto &c : matrix_columns)
+        csv << ", " << c;
+    for (auto &c : profile_columns)
+        csv << ", " << c;
+    csv << '\n';
+    csv.precision(17);
+    for (bench_result_ex &r : results)
+    {
+        csv << r.name << ", " << r.original_size << ", " << r.compressed_size << ", " << r.compression_time << ", "
+            << r.decompression_time << ", " << r.max_error << ", " << r.mean_absolute_error << ", " << r.dataset
+            << ", " << r.error_bound << ", " << r.matrix_id << ", " << r.matrix_index << ", " << r.matrix_size
+            << ", " << r.shard;
+        data_profile &p = r.profile;
+        csv << ", " << p.count << ", " << p.nan_count << ", " << p.inf_count << ", " << p.min << ", " << p.max << ", "
+            << p.lag1_autocorrelation << ", " << p.mean_abs_diff1 << ", " << p.mean_abs_diff2 << ", "
+            << p.repeated_fraction << ", " << p.cardinality << ", " << p.byte_entropy_string() << '\n';
+    }
+}
+
+static std::vector<std::string> split_csv_line(const std::string &line)
+{
+    auto cells = split_string(line, ',');
+    for (auto &cell : cells)
+        cell.erase(0, cell.find_first_not_of(' '));
+    return cells;
+}
+
+std::vector<bench_result_ex> results_from_file(std::string path)
+{
+    std::ifstream csv(path);
+    if (!csv.is_open())
+        throw std::runtime_error("cannot open file");
+    std::string line;
+    if (!std::getline(csv, line))
+        throw std::runtime_error("empty results file: " + path);
+
+    // columns are looked up by name so files written by older builds still load
+    std::map<std::string, size_t> index;
+    auto header = split_csv_line(line);
+    for (size_t i = 0; i < header.size(); i++)
+        index[header[i]] = i;
+    for (auto &c : result_columns)
+        if (!index.contains(c))
+            throw std::runtime_error("results file " + path + " is missing column \"" + c + "\"");
+
+    std::vector<bench_result_ex> results;
+    while (std::getline(csv, line))
+    {
+        if (line.empty())
+            continue;
+        auto cells = split_csv_line(line);
+        if (cells.size() != header.size())
+            throw std::runtime_error("malformed row in " + path + ": " + line);
+        bench_result_ex r;
+        r.name = cells[index["name"]];
+        r.original_size = std::stoull(cells[index["original_size"]]);
+        r.compressed_size = std::stoull(cells[index["compressed_size"]]);
+        r.compression_time = std::stod(cells[index["compression_time"]]);
+        r.decompression_time = std::stod(cells[index["decompression_time"]]);
+        r.max_error = std::stod(cells[index["max_error"]]);
+        r.mean_absolute_error = std::stod(cells[index["mean_absolute_error"]]);
+        if (index.contains("dataset"))
+            r.dataset = cells[index["dataset"]];
+        if (index.contains("error_bound"))
+            r.error_bound = std::stod(cells[index["error_bound"]]);
+        if (index.contains("matrix_id"))
+            r.matrix_id = cells[index["matrix_id"]];
+        if (index.contains("matrix_index"))
+            r.matrix_index = std::stoull(cells[index["matrix_index"]]);
+        if (index.contains("matrix_size"))
+            r.matrix_size = std::stoull(cells[index["matrix_size"]]);
+        if (index.contains("shard"))
+            r.shard = cells[index["shard"]];
+        if (index.contains("byte_entropy"))
+        {
+            data_profile &p = r.profile;
+            p.count = std::stoull(cells[index["count"]]);
+            p.nan_count = std::stoull(cells[index["nan_count"]]);
+            p.inf_count = std::stoull(cells[index["inf_count"]]);
+            p.min = std::stod(cells[index["min"]]);
+            p.max = std::stod(cells[index["max"]]);
+            p.lag1_autocorrelation = std::stod(cells[index["lag1_autocorrelation"]]);
+            p.mean_abs_diff1 = std::stod(cells[index["mean_abs_diff1"]]);
+            p.mean_abs_diff2 = std::stod(cells[index["mean_abs_diff2"]]);
+            p.repeated_fraction = std::stod(cells[index["repeated_fraction"]]);
+            p.cardinality = std::stod(cells[index["cardinality"]]);
+            for (auto &e : split_string(cells[index["byte_entropy"]], ';'))
+                p.byte_entropy.push_back(std::stod(e));
+        }
+        results.push_back(r);
+    }
+    return results;
+}
+
+link_cost estimate_link_cost(const bench_result &result, double bandwidth)
+{
+    link_cost c;
+    c.bandwidth = bandwidth;
+    c.transfer_time = result.compressed_size / bandwidth;
+    c.sequential_time = result.compression_time + c.transfer_time + result.decompression_time;
+    // when the array is streamed through in chunks the three stages overlap and the slowest one dominates
+    c.pipelined_time = std::max({result.compression_time, c.transfer_time, result.decompression_time});
+    return c;
+}
@@ -0,0 +1,172 @@
+#include "buffer.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+#include <unordered_map>
+#include <vector>
+
+namespace buffer_pool
+{
+constexpr size_t huge_page_size = 2 << 20;
+
+struct block
+{
+    size_t size;
+    bool mapped;
+};
+
+struct pool_state
+{
+    std::mutex mutex;
+    std::multimap<size_t, void *> cache; // class size -> released block
+    std::unordered_map<void *, block> live;
+    buffer_pool_stats stats;
+    size_t cache_limit = size_t(2) << 30;
+    size_t huge_page_threshold = huge_page_size;
+};
+
+// never destroyed, so buffers released by static destructors still find it
+static pool_state &get_pool()
+{
+    static pool_state *pool = new pool_state;
+    return *pool;
+}
+
+static size_t size_class(pool_state &pool, size_t size)
+{
+    if (size >= pool.huge_page_threshold)
+        return (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+    return std::bit_ceil(std::max(size, alignment));
+}
+
+static void *map_huge(pool_state &pool, size_t size)
+{
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED)
+    {
+        pool.stats.huge_blocks++;
+        return ptr;
+    }
+
+    // over-allocate so the block can start on a huge page boundary, which transparent huge pages need
+    size_t padded = size + huge_page_size;
+    auto base = static_cast<std::byte *>(
+        mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        throw std::bad_alloc();
+    auto address = reinterpret_cast<uintptr_t>(base);
+    size_t head = (huge_page_size - address % huge_page_size) % huge_page_size;
+    if (head)
+        munmap(base, head);
+    if (huge_page_size - head)
+        munmap(base + head + size, huge_page_size - head);
+    madvise(base + head, size, MADV_HUGEPAGE);
+    pool.stats.thp_blocks++;
+    return base + head;
+}
+
+static void free_block(void *ptr, const block &b)
+{
+    if (b.mapped)
+        munmap(ptr, b.size);
+    else
+        std::free(ptr);
+}
+
+void *allocate(size_t size)
+{
+    pool_state &pool = get_pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    size_t cls = size_class(pool, size);
+    void *ptr;
+    auto cached = pool.cache.find(cls);
+    if (cached != pool.cache.end())
+    {
+        ptr = cached->second;
+        pool.cache.erase(cached);
+        pool.stats.bytes_cached -= cls;
+        pool.stats.reuses++;
+    }
+    else if (cls >= pool.huge_page_threshold)
+    {
+        ptr = map_huge(pool, cls);
+        pool.live[ptr] = {cls, true};
+        pool.stats.allocations++;
+    }
+    else
+    {
+        ptr = std::aligned_alloc(alignment, cls);
+        if (!ptr)
+            throw std::bad_alloc();
+        pool.live[ptr] = {cls, false};
+        pool.stats.allocations++;
+    }
+    pool.stats.bytes_in_use += cls;
+    pool.stats.peak_bytes_in_use = std::max(pool.stats.peak_bytes_in_use, pool.stats.bytes_in_use);
+    return ptr;
+}
+
+void release(void *ptr)
+{
+    if (!ptr)
+        return;
+    pool_state &pool = get_pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    // called from destructors, so a pointer the pool never handed out must not throw
+    auto it = pool.live.find(ptr);
+    assert(it != pool.live.end());
+    if (it == pool.live.end())
+        return;
+    const block &b = it->second;
+    pool.stats.bytes_in_use -= b.size;
+    if (pool.stats.bytes_cached + b.size <= pool.cache_limit)
+    {
+        pool.cache.emplace(b.size, ptr);
+        pool.stats.bytes_cached += b.size;
+        return;
+    }
+    free_block(ptr, b);
+    pool.live.erase(it);
+}
+
+buffer_pool_stats stats()
+{
+    pool_state &pool = get_pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.stats;
+}
+
+void trim()
+{
+    pool_state &pool = get_pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (auto &[cls, ptr] : pool.cache)
+    {
+        free_block(ptr, pool.live.at(ptr));
+        pool.live.erase(ptr);
+    }
+    pool.cache.clear();
+    pool.stats.bytes_cached = 0;
+}
+
+void set_cache_limit(size_t bytes)
+{
+    pool_state &pool = get_pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.cache_limit = bytes;
+}
+
+void set_huge_page_threshold(size_t bytes)
+{
+    pool_state &pool = get_pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.huge_page_threshold = bytes;
+}
+} // namespace buffer_pool
\ No newline at end of file
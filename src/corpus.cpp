@@ -0,0 +1,179 @@
+#include "corpus.hpp"
+#include "benchmark.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+static const std::vector<std::string> raw_extensions = {".f32", ".f64", ".bin", ".raw", ".dat"};
+
+static char parse_dtype(const std::string &dtype)
+{
+    if (dtype == "f" || dtype == "f4" || dtype == "float" || dtype == "float32")
+        return 'f';
+    if (dtype == "d" || dtype == "f8" || dtype == "double" || dtype == "float64")
+        return 'd';
+    throw std::runtime_error("unsupported dtype \"" + dtype + "\"");
+}
+
+// https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+static void read_npy_header(corpus_file &file)
+{
+    std::ifstream f(file.path, std::ios::binary);
+    char magic[8];
+    if (!f.read(magic, sizeof(magic)) || std::memcmp(magic, "\x93NUMPY", 6) != 0)
+        throw std::runtime_error(file.path + " is not a .npy file");
+    uint32_t header_len = 0;
+    size_t len_size = magic[6] == 1 ? 2 : 4;
+    f.read(reinterpret_cast<char *>(&header_len), len_size);
+    std::string header(header_len, ' ');
+    if (!f.read(header.data(), header_len))
+        throw std::runtime_error("truncated header in " + file.path);
+    file.offset = sizeof(magic) + len_size + header_len;
+
+    auto descr = header.find("'descr'");
+    if (descr == std::string::npos)
+        throw std::runtime_error("no dtype in " + file.path);
+    auto start = header.find('\'', descr + 7) + 1;
+    std::string dtype = header.substr(start, header.find('\'', start) - start);
+    if (dtype == "<f4")
+        file.dtype = 'f';
+    else if (dtype == "<f8")
+        file.dtype = 'd';
+    else
+        throw std::runtime_error(file.path + " has unsupported dtype " + dtype);
+    // the array is benchmarked as a flat sequence in storage order, so shape and fortran_order do not matter
+}
+
+corpus_file describe_file(const std::string &path)
+{
+    corpus_file file;
+    file.path = path;
+    auto ext = std::filesystem::path(path).extension().string();
+    if (ext == ".npy")
+        read_npy_header(file);
+    else if (ext == ".f64")
+        file.dtype = 'd';
+    return file;
+}
+
+std::vector<corpus_file> load_corpus(const std::string &path)
+{
+    std::vector<corpus_file> files;
+    if (std::filesystem::is_directory(path))
+    {
+        std::vector<std::string> paths;
+        for (auto &entry : std::filesystem::directory_iterator(path))
+        {
+            auto ext = entry.path().extension().string();
+            if (entry.is_regular_file() &&
+                (ext == ".npy" || std::find(raw_extensions.begin(), raw_extensions.end(), ext) != raw_extensions.end()))
+                paths.push_back(entry.path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+        for (auto &p : paths)
+            files.push_back(describe_file(p));
+        return files;
+    }
+
+    std::ifstream manifest(path);
+    if (!manifest.is_open())
+        throw std::runtime_error("cannot open corpus " + path);
+    auto base = std::filesystem::path(path).parent_path();
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream s(line);
+        std::string file_path, token;
+        if (!(s >> file_path))
+            continue;
+        corpus_file file = describe_file((base / file_path).string());
+        while (s >> token)
+        {
+            char *end;
+            double error_bound = std::strtod(token.c_str(), &end);
+            if (*end == '\0')
+                file.error_bounds = {error_bound};
+            else if (std::filesystem::path(file.path).extension() == ".npy")
+                throw std::runtime_error("dtype of " + file.path + " is given by its header");
+            else
+                file.dtype = parse_dtype(token);
+        }
+        files.push_back(file);
+    }
+    return files;
+}
+
+template <typename F> std::vector<F> read_corpus_file(const corpus_file &file)
+{
+    std::ifstream f(file.path, std::ios::binary | std::ios::ate);
+    if (!f.is_open())
+        throw std::runtime_error("cannot open file " + file.path);
+    size_t size = static_cast<size_t>(f.tellg()) - file.offset;
+    if (size % sizeof(F) != 0)
+        throw std::runtime_error(string_format("%s is not a whole number of %zu byte values", file.path.c_str(),
+                                               sizeof(F)));
+    std::vector<F> data(size / sizeof(F));
+    f.seekg(file.offset);
+    if (!f.read(reinterpret_cast<char *>(data.data()), size))
+        throw std::runtime_error("cannot read file " + file.path);
+    return data;
+}
+template std::vector<float> read_corpus_file(const corpus_file &file);
+template std::vector<double> read_corpus_file(const corpus_file &file);
+
+std::vector<corpus_aggregate> aggregate_corpus(std::vector<bench_result_ex> &results,
+                                               const std::vector<corpus_file> &files, std::vector<double> error_bounds)
+{
+    std::map<std::string, const std::vector<double> *> bounds_of;
+    for (auto &file : files)
+        bounds_of[file.path] = file.error_bounds.empty() ? &error_bounds : &file.error_bounds;
+
+    std::vector<corpus_aggregate> aggregates;
+    std::map<std::pair<std::string, size_t>, size_t> index;
+    std::vector<std::set<double>> bounds_seen;
+    for (bench_result_ex &r : results)
+    {
+        auto &bounds = *bounds_of.at(r.dataset);
+        size_t slot = std::find(bounds.begin(), bounds.end(), r.error_bound) - bounds.begin();
+        auto key = std::make_pair(r.name, slot);
+        if (!index.contains(key))
+        {
+            index[key] = aggregates.size();
+            aggregates.emplace_back();
+            aggregates.back().name = r.name;
+            bounds_seen.emplace_back();
+        }
+        size_t i = index[key];
+        corpus_aggregate &a = aggregates[i];
+        bounds_seen[i].insert(r.error_bound);
+        a.files++;
+        a.original_size += r.original_size;
+        a.compressed_size += r.compressed_size;
+        a.compression_time += r.compression_time;
+        a.decompression_time += r.decompression_time;
+        // sums of logs for now, turned into geometric means below
+        a.ratio_geomean += std::log((double)r.compressed_size / r.original_size);
+        a.compression_rate_geomean += std::log(r.compression_data_rate());
+        a.decompression_rate_geomean += std::log(r.decompression_data_rate());
+    }
+    for (size_t i = 0; i < aggregates.size(); i++)
+    {
+        corpus_aggregate &a = aggregates[i];
+        a.ratio_geomean = std::exp(a.ratio_geomean / a.files);
+        a.compression_rate_geomean = std::exp(a.compression_rate_geomean / a.files);
+        a.decompression_rate_geomean = std::exp(a.decompression_rate_geomean / a.files);
+        a.error_bound = bounds_seen[i].size() == 1 ? string_format("%g", *bounds_seen[i].begin()) : "per file";
+    }
+    return aggregates;
+}
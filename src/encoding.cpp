@@ -0,0 +1,64 @@
+#include "encoding.hpp"
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+std::span<const std::byte> Encoding::encode(std::span<const std::byte> input)
+{
+    byte_buffer &encoded_buffer = thread_buffers.get().encoded;
+    encoded_buffer.resize(max_encoded_size(input.size_bytes()));
+    size_t encoded_sz = encode_into(input, encoded_buffer);
+    if (encoded_sz > encoded_buffer.size())
+    {
+        encoded_buffer.resize(encoded_sz);
+        encoded_sz = encode_into(input, encoded_buffer);
+    }
+    return std::span<const std::byte>(encoded_buffer).first(encoded_sz);
+}
+
+std::span<const std::byte> Encoding::decode(std::span<const std::byte> input)
+{
+    byte_buffer &decoded_buffer = thread_buffers.get().decoded;
+    decoded_buffer.resize(decoded_size(input));
+    size_t decoded_sz = decode_into(input, decoded_buffer);
+    if (decoded_sz > decoded_buffer.size())
+    {
+        throw std::runtime_error(name() + " decoded more than its reported size");
+    }
+    return std::span<const std::byte>(decoded_buffer).first(decoded_sz);
+}
+
+size_t Encoding::encode_segments_into(std::span<const std::span<const std::byte>> segments, std::span<std::byte> output)
+{
+    if (segments.size() == 1)
+        return encode_into(segments[0], output);
+    size_t total = 0;
+    for (auto segment : segments)
+        total += segment.size();
+    byte_buffer &gathered = thread_buffers.get().gathered;
+    gathered.resize(total);
+    size_t pos = 0;
+    for (auto segment : segments)
+    {
+        std::memcpy(gathered.data() + pos, segment.data(), segment.size());
+        pos += segment.size();
+    }
+    return encode_into(gathered, output);
+}
+
+std::span<const std::byte> Encoding::encode_segments(std::span<const std::span<const std::byte>> segments)
+{
+    size_t total = 0;
+    for (auto segment : segments)
+        total += segment.size();
+    byte_buffer &encoded_buffer = thread_buffers.get().encoded;
+    encoded_buffer.resize(max_encoded_size(total));
+    size_t encoded_sz = encode_segments_into(segments, encoded_buffer);
+    if (encoded_sz > encoded_buffer.size())
+    {
+        encoded_buffer.resize(encoded_sz);
+        encoded_sz = encode_segments_into(segments, encoded_buffer);
+    }
+    return std::span<const std::byte>(encoded_buffer).first(encoded_sz);
+}
\ No newline at end of file
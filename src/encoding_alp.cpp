@@ -0,0 +1,587 @@
+#include "encoding.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+constexpr size_t alp_vector_size = 1024;
+constexpr size_t alp_row_group_vectors = 100;
+constexpr size_t alp_sampled_vectors = 8;
+constexpr size_t alp_samples_per_vector = 32;
+constexpr size_t alp_max_candidates = 5;
+// a packed width that marks a raw ALP vector, and an exception count that marks a raw ALP_rd vector
+constexpr uint8_t alp_raw_width = 255;
+constexpr uint16_t alp_rd_raw_exceptions = 0xffff;
+constexpr unsigned alp_rd_max_left_bits = 16;
+constexpr size_t alp_rd_dictionary_size = 8;
+
+enum alp_scheme : uint8_t
+{
+    alp_decimal = 0,
+    alp_real = 1
+};
+
+template <typename T> struct alp_traits;
+template <> struct alp_traits<double>
+{
+    typedef uint64_t uint_type;
+    static constexpr unsigned max_exponent = 18;
+    static constexpr double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8, 1e9,
+                                        1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    static constexpr double inverse_powers[] = {1e0,   1e-1,  1e-2,  1e-3,  1e-4,  1e-5,  1e-6,  1e-7,  1e-8, 1e-9,
+                                                1e-10, 1e-11, 1e-12, 1e-13, 1e-14, 1e-15, 1e-16, 1e-17, 1e-18};
+    // adding and subtracting 2^52 + 2^51 rounds to the nearest integer anything smaller than 2^51
+    static constexpr double magic = 6755399441055744.0;
+    static constexpr double limit = 2251799813685248.0;
+};
+template <> struct alp_traits<float>
+{
+    typedef uint32_t uint_type;
+    static constexpr unsigned max_exponent = 10;
+    static constexpr float powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    static constexpr float inverse_powers[] = {1e0f,  1e-1f, 1e-2f, 1e-3f, 1e-4f, 1e-5f,
+                                               1e-6f, 1e-7f, 1e-8f, 1e-9f, 1e-10f};
+    // 2^23 + 2^22, for anything smaller than 2^22
+    static constexpr float magic = 12582912.0f;
+    static constexpr float limit = 4194304.0f;
+};
+
+template <typename T> static inline T alp_decode_value(int64_t digits, unsigned exponent, unsigned factor)
+{
+    return static_cast<T>(digits) * alp_traits<T>::powers[factor] * alp_traits<T>::inverse_powers[exponent];
+}
+
+// the integer for value with this exponent and factor, if it decodes back to exactly the same bits
+template <typename T> static inline bool alp_encode_value(T value, unsigned exponent, unsigned factor, int64_t &digits)
+{
+    typedef alp_traits<T> t;
+    // factor <= exponent, so a value past the limit scales past it too, and scaling one could overflow, which traps
+    // under the floating point exceptions main enables; also false for NaN
+    if (!(value >= -t::limit && value <= t::limit))
+        return false;
+    const T scaled = value * t::powers[exponent] * t::inverse_powers[factor];
+    if (!(scaled >= -t::limit && scaled <= t::limit))
+        return false;
+    digits = static_cast<int64_t>((scaled + t::magic) - t::magic);
+    return std::bit_cast<typename t::uint_type>(alp_decode_value<T>(digits, exponent, factor)) ==
+           std::bit_cast<typename t::uint_type>(value);
+}
+
+// Packs 64 values of width bits into width words, and back. Fully unrolled, so every shift is a constant.
+template <unsigned W> static void alp_pack_group(const uint64_t *in, std::byte *out)
+{
+    if constexpr (W > 0)
+    {
+        uint64_t words[W] = {};
+#pragma GCC unroll 64
+        for (unsigned i = 0; i < 64; i++)
+        {
+            const unsigned bit = i * W, word = bit / 64, offset = bit % 64;
+            words[word] |= in[i] << offset;
+            if (offset + W > 64)
+                words[word + 1] |= in[i] >> (64 - offset);
+        }
+        std::memcpy(out, words, sizeof(words));
+    }
+}
+
+template <unsigned W> static void alp_unpack_group(const std::byte *in, uint64_t *out)
+{
+    if constexpr (W == 0)
+        std::fill_n(out, 64, 0);
+    else
+    {
+        uint64_t words[W];
+        std::memcpy(words, in, sizeof(words));
+        constexpr uint64_t mask = W == 64 ? ~uint64_t(0) : (uint64_t(1) << W) - 1;
+#pragma GCC unroll 64
+        for (unsigned i = 0; i < 64; i++)
+        {
+            const unsigned bit = i * W, word = bit / 64, offset = bit % 64;
+            uint64_t value = words[word] >> offset;
+            if (offset + W > 64)
+                value |= words[word + 1] << (64 - offset);
+            out[i] = value & mask;
+        }
+    }
+}
+
+template <size_t... W> static constexpr auto alp_make_packers(std::index_sequence<W...>)
+{
+    return std::array{&alp_pack_group<W>...};
+}
+template <size_t... W> static constexpr auto alp_make_unpackers(std::index_sequence<W...>)
+{
+    return std::array{&alp_unpack_group<W>...};
+}
+constexpr auto alp_packers = alp_make_packers(std::make_index_sequence<65>());
+constexpr auto alp_unpackers = alp_make_unpackers(std::make_index_sequence<65>());
+
+// bytes taken by count values packed at width bits, count being a multiple of 64
+static size_t alp_packed_size(size_t count, unsigned width)
+{
+    return count / 64 * width * sizeof(uint64_t);
+}
+
+static void alp_pack(const uint64_t *in, size_t count, unsigned width, std::byte *out)
+{
+    for (size_t i = 0; i < count; i += 64)
+        alp_packers[width](in + i, out + alp_packed_size(i, width));
+}
+
+static void alp_unpack(const std::byte *in, size_t count, unsigned width, uint64_t *out)
+{
+    for (size_t i = 0; i < count; i += 64)
+        alp_unpackers[width](in + alp_packed_size(i, width), out + i);
+}
+
+struct alp_writer
+{
+    std::byte *p;
+
+    template <typename V> void put(V value)
+    {
+        std::memcpy(p, &value, sizeof(V));
+        p += sizeof(V);
+    }
+    std::byte *take(size_t size)
+    {
+        std::byte *start = p;
+        p += size;
+        return start;
+    }
+};
+
+struct alp_reader
+{
+    const std::byte *p;
+    const std::byte *end;
+
+    const std::byte *take(size_t size)
+    {
+        if (size_t(end - p) < size)
+            throw std::runtime_error("Truncated ALP input");
+        const std::byte *start = p;
+        p += size;
+        return start;
+    }
+    template <typename V> V get()
+    {
+        V value;
+        std::memcpy(&value, take(sizeof(V)), sizeof(V));
+        return value;
+    }
+};
+
+// Estimated bits for a sample with this exponent and factor: the packed width of the integers, plus the value and
+// position of every exception.
+template <typename T> static size_t alp_estimate(const T *sample, size_t count, unsigned exponent, unsigned factor)
+{
+    int64_t min = INT64_MAX, max = INT64_MIN;
+    size_t exceptions = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        int64_t digits;
+        if (alp_encode_value(sample[i], exponent, factor, digits))
+        {
+            min = std::min(min, digits);
+            max = std::max(max, digits);
+        }
+        else
+            exceptions++;
+    }
+    size_t width = exceptions == count ? 0 : std::bit_width(uint64_t(max) - uint64_t(min));
+    return count * width + exceptions * (sizeof(T) * 8 + 16);
+}
+
+// up to alp_samples_per_vector values spread evenly over values
+template <typename T> static size_t alp_sample(const T *values, size_t count, T *sample)
+{
+    size_t n = std::min(count, alp_samples_per_vector);
+    for (size_t i = 0; i < n; i++)
+        sample[i] = values[i * count / n];
+    return n;
+}
+
+template <typename T> struct alp_row_group_plan
+{
+    typedef typename alp_traits<T>::uint_type U;
+
+    alp_scheme scheme = alp_decimal;
+    std::vector<std::pair<uint8_t, uint8_t>> candidates; // exponent and factor
+    unsigned right_bits = 0;
+    std::vector<uint16_t> dictionary;
+
+    // Samples a few vectors of the row group. Each sampled vector's best exponent and factor, over all of them, is a
+    // candidate; the ones that win most often are kept. ALP_rd is chosen when its estimate on the same sample is lower.
+    alp_row_group_plan(const T *values, size_t count)
+    {
+        constexpr unsigned bit_size = sizeof(T) * 8;
+        size_t vectors = (count + alp_vector_size - 1) / alp_vector_size;
+        size_t sampled = std::min(vectors, alp_sampled_vectors);
+        std::vector<T> sample;
+        std::vector<std::pair<std::pair<uint8_t, uint8_t>, std::pair<size_t, size_t>>> wins; // {e, f} -> {wins, bits}
+        size_t alp_bits = 0;
+        for (size_t s = 0; s < sampled; s++)
+        {
+            size_t v = s * vectors / sampled;
+            size_t length = std::min(alp_vector_size, count - v * alp_vector_size);
+            T vector_sample[alp_samples_per_vector];
+            size_t n = alp_sample(values + v * alp_vector_size, length, vector_sample);
+            sample.insert(sample.end(), vector_sample, vector_sample + n);
+
+            std::pair<uint8_t, uint8_t> best{0, 0};
+            size_t best_bits = SIZE_MAX;
+            for (unsigned e = 0; e <= alp_traits<T>::max_exponent; e++)
+                for (unsigned f = 0; f <= e; f++)
+                {
+                    size_t bits = alp_estimate(vector_sample, n, e, f);
+                    if (bits < best_bits)
+                    {
+                        best_bits = bits;
+                        best = {uint8_t(e), uint8_t(f)};
+                    }
+                }
+            alp_bits += best_bits;
+            auto it = std::find_if(wins.begin(), wins.end(), [&](auto &w) { return w.first == best; });
+            if (it == wins.end())
+                wins.push_back({best, {1, best_bits}});
+            else
+                it->second = {it->second.first + 1, it->second.second + best_bits};
+        }
+        std::sort(wins.begin(), wins.end(), [](auto &a, auto &b) {
+            return a.second.first != b.second.first ? a.second.first > b.second.first
+                                                    : a.second.second < b.second.second;
+        });
+        for (size_t i = 0; i < std::min(wins.size(), alp_max_candidates); i++)
+            candidates.push_back(wins[i].first);
+
+        // ALP_rd: the split with the smallest estimate, the right bits packed as they are
+        size_t rd_bits = SIZE_MAX;
+        std::vector<U> lefts(sample.size());
+        for (unsigned left_bits = 1; left_bits <= alp_rd_max_left_bits; left_bits++)
+        {
+            unsigned right = bit_size - left_bits;
+            for (size_t i = 0; i < sample.size(); i++)
+                lefts[i] = std::bit_cast<U>(sample[i]) >> right;
+            std::sort(lefts.begin(), lefts.end());
+            std::vector<std::pair<size_t, uint16_t>> runs; // count, left part
+            for (size_t i = 0; i < lefts.size();)
+            {
+                size_t j = i;
+                while (j < lefts.size() && lefts[j] == lefts[i])
+                    j++;
+                runs.push_back({j - i, uint16_t(lefts[i])});
+                i = j;
+            }
+            std::stable_sort(runs.begin(), runs.end(), [](auto &a, auto &b) { return a.first > b.first; });
+            size_t entries = std::min(runs.size(), alp_rd_dictionary_size);
+            size_t covered = 0;
+            for (size_t i = 0; i < entries; i++)
+                covered += runs[i].first;
+            unsigned index_bits = entries <= 1 ? 0 : std::bit_width(entries - 1);
+            size_t bits = sample.size() * (right + index_bits) + (sample.size() - covered) * (16 + 16);
+            if (bits < rd_bits)
+            {
+                rd_bits = bits;
+                right_bits = right;
+                dictionary.clear();
+                for (size_t i = 0; i < entries; i++)
+                    dictionary.push_back(runs[i].second);
+            }
+        }
+        if (rd_bits < alp_bits)
+            scheme = alp_real;
+    }
+};
+
+// Vector layouts:
+//   ALP     [width][exponent][factor][uint16 exceptions][int64 base][packed][uint16 positions][exception values]
+//           or [alp_raw_width][values]
+//   ALP_rd  [uint16 exceptions][packed dictionary indices][packed right bits][uint16 positions][uint16 left parts]
+//           or [alp_rd_raw_exceptions][values]
+// Packed arrays hold the vector's length rounded up to 64 values.
+template <typename T> static void alp_encode_vector(const alp_row_group_plan<T> &plan, const T *values, size_t count,
+                                                    alp_writer &out)
+{
+    size_t padded = (count + 63) / 64 * 64;
+    uint64_t packed[alp_vector_size];
+    uint16_t positions[alp_vector_size];
+
+    if (plan.scheme == alp_decimal)
+    {
+        auto [exponent, factor] = plan.candidates[0];
+        if (plan.candidates.size() > 1)
+        {
+            T sample[alp_samples_per_vector];
+            size_t n = alp_sample(values, count, sample);
+            size_t best_bits = SIZE_MAX;
+            for (auto [e, f] : plan.candidates)
+            {
+                size_t bits = alp_estimate(sample, n, e, f);
+                if (bits < best_bits)
+                {
+                    best_bits = bits;
+                    exponent = e;
+                    factor = f;
+                }
+            }
+        }
+
+        int64_t digits[alp_vector_size];
+        size_t exceptions = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!alp_encode_value(values[i], exponent, factor, digits[i]))
+                positions[exceptions++] = uint16_t(i);
+        }
+        // exceptions and padding take a value that is already there, so they do not widen the range
+        int64_t filler = 0;
+        for (size_t i = 0, j = 0; i < count; i++)
+        {
+            if (j < exceptions && positions[j] == i)
+                j++;
+            else
+            {
+                filler = digits[i];
+                break;
+            }
+        }
+        for (size_t j = 0; j < exceptions; j++)
+            digits[positions[j]] = filler;
+        std::fill(digits + count, digits + padded, filler);
+        int64_t base = *std::min_element(digits, digits + padded);
+        int64_t top = *std::max_element(digits, digits + padded);
+        unsigned width = std::bit_width(uint64_t(top) - uint64_t(base));
+
+        size_t size = 13 + alp_packed_size(padded, width) + exceptions * (2 + sizeof(T));
+        if (size > 1 + count * sizeof(T))
+        {
+            out.put(alp_raw_width);
+            std::memcpy(out.take(count * sizeof(T)), values, count * sizeof(T));
+            return;
+        }
+        for (size_t i = 0; i < padded; i++)
+            packed[i] = uint64_t(digits[i]) - uint64_t(base);
+        out.put(uint8_t(width));
+        out.put(exponent);
+        out.put(factor);
+        out.put(uint16_t(exceptions));
+        out.put(base);
+        alp_pack(packed, padded, width, out.take(alp_packed_size(padded, width)));
+        std::memcpy(out.take(exceptions * 2), positions, exceptions * 2);
+        for (size_t j = 0; j < exceptions; j++)
+            out.put(values[positions[j]]);
+        return;
+    }
+
+    typedef typename alp_traits<T>::uint_type U;
+    const unsigned right_bits = plan.right_bits;
+    const unsigned index_bits = plan.dictionary.size() <= 1 ? 0 : std::bit_width(plan.dictionary.size() - 1);
+    const U right_mask = (U(1) << right_bits) - 1;
+    uint64_t rights[alp_vector_size];
+    uint16_t lefts[alp_vector_size];
+    size_t exceptions = 0;
+    for (size_t i = 0; i < padded; i++)
+    {
+        U bits = i < count ? std::bit_cast<U>(values[i]) : 0;
+        rights[i] = bits & right_mask;
+        uint16_t left = uint16_t(bits >> right_bits);
+        size_t index = std::find(plan.dictionary.begin(), plan.dictionary.end(), left) - plan.dictionary.begin();
+        if (index == plan.dictionary.size())
+        {
+            index = 0;
+            if (i < count)
+            {
+                positions[exceptions] = uint16_t(i);
+                lefts[exceptions++] = left;
+            }
+        }
+        packed[i] = index;
+    }
+    size_t size = 2 + alp_packed_size(padded, index_bits) + alp_packed_size(padded, right_bits) + exceptions * 4;
+    if (size > 2 + count * sizeof(T))
+    {
+        out.put(alp_rd_raw_exceptions);
+        std::memcpy(out.take(count * sizeof(T)), values, count * sizeof(T));
+        return;
+    }
+    out.put(uint16_t(exceptions));
+    alp_pack(packed, padded, index_bits, out.take(alp_packed_size(padded, index_bits)));
+    alp_pack(rights, padded, right_bits, out.take(alp_packed_size(padded, right_bits)));
+    std::memcpy(out.take(exceptions * 2), positions, exceptions * 2);
+    std::memcpy(out.take(exceptions * 2), lefts, exceptions * 2);
+}
+
+template <typename T> static void alp_decode_vector(alp_scheme scheme, unsigned right_bits,
+                                                    const std::vector<uint16_t> &dictionary, alp_reader &in,
+                                                    size_t count, std::byte *out)
+{
+    typedef typename alp_traits<T>::uint_type U;
+    size_t padded = (count + 63) / 64 * 64;
+    uint64_t packed[alp_vector_size];
+    T values[alp_vector_size];
+
+    if (scheme == alp_decimal)
+    {
+        uint8_t width = in.get<uint8_t>();
+        if (width == alp_raw_width)
+        {
+            std::memcpy(out, in.take(count * sizeof(T)), count * sizeof(T));
+            return;
+        }
+        uint8_t exponent = in.get<uint8_t>(), factor = in.get<uint8_t>();
+        uint16_t exceptions = in.get<uint16_t>();
+        int64_t base = in.get<int64_t>();
+        if (width > 64 || exponent > alp_traits<T>::max_exponent || factor > exponent || exceptions > count)
+            throw std::runtime_error("Corrupt ALP vector");
+        alp_unpack(in.take(alp_packed_size(padded, width)), padded, width, packed);
+        const T scale = alp_traits<T>::powers[factor], inverse = alp_traits<T>::inverse_powers[exponent];
+        for (size_t i = 0; i < count; i++)
+            values[i] = static_cast<T>(static_cast<int64_t>(packed[i] + uint64_t(base))) * scale * inverse;
+        const std::byte *positions = in.take(exceptions * 2);
+        const std::byte *patches = in.take(exceptions * sizeof(T));
+        for (size_t j = 0; j < exceptions; j++)
+        {
+            uint16_t position;
+            std::memcpy(&position, positions + j * 2, 2);
+            if (position >= count)
+                throw std::runtime_error("Corrupt ALP exception");
+            std::memcpy(&values[position], patches + j * sizeof(T), sizeof(T));
+        }
+        std::memcpy(out, values, count * sizeof(T));
+        return;
+    }
+
+    uint16_t exceptions = in.get<uint16_t>();
+    if (exceptions == alp_rd_raw_exceptions)
+    {
+        std::memcpy(out, in.take(count * sizeof(T)), count * sizeof(T));
+        return;
+    }
+    if (exceptions > count)
+        throw std::runtime_error("Corrupt ALP_rd vector");
+    const unsigned index_bits = dictionary.size() <= 1 ? 0 : std::bit_width(dictionary.size() - 1);
+    uint64_t rights[alp_vector_size];
+    alp_unpack(in.take(alp_packed_size(padded, index_bits)), padded, index_bits, packed);
+    alp_unpack(in.take(alp_packed_size(padded, right_bits)), padded, right_bits, rights);
+    // a dictionary of 2^index_bits entries, so corrupt indices still stay inside it
+    uint16_t lookup[alp_rd_dictionary_size] = {};
+    std::copy(dictionary.begin(), dictionary.end(), lookup);
+    U bits[alp_vector_size];
+    for (size_t i = 0; i < count; i++)
+        bits[i] = (U(lookup[packed[i]]) << right_bits) | U(rights[i]);
+    const std::byte *positions = in.take(exceptions * 2);
+    const std::byte *lefts = in.take(exceptions * 2);
+    for (size_t j = 0; j < exceptions; j++)
+    {
+        uint16_t position, left;
+        std::memcpy(&position, positions + j * 2, 2);
+        std::memcpy(&left, lefts + j * 2, 2);
+        if (position >= count)
+            throw std::runtime_error("Corrupt ALP_rd exception");
+        bits[position] = (U(left) << right_bits) | U(rights[position]);
+    }
+    std::memcpy(values, bits, count * sizeof(T));
+    std::memcpy(out, values, count * sizeof(T));
+}
+
+template <typename T> size_t Alp<T>::max_encoded_size(size_t input_size)
+{
+    size_t values = input_size / sizeof(T);
+    size_t vectors = (values + alp_vector_size - 1) / alp_vector_size;
+    size_t row_groups = (vectors + alp_row_group_vectors - 1) / alp_row_group_vectors;
+    // a vector is never larger than raw with its marker; a row group header is at most 3 + 2 * 8 bytes
+    return sizeof(size_t) + row_groups * (3 + 2 * alp_rd_dictionary_size) + vectors * 2 + values * sizeof(T);
+}
+
+template <typename T> size_t Alp<T>::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t input_sz = input.size_bytes();
+    if (input_sz % sizeof(T) != 0)
+        throw std::runtime_error("ALP input size is not a multiple of the value size");
+    size_t needed = max_encoded_size(input_sz);
+    if (output.size() < needed)
+        return needed;
+
+    size_t count = input_sz / sizeof(T);
+    // pool buffers are aligned and read in place, other input is copied once
+    const T *values = reinterpret_cast<const T *>(input.data());
+    std::vector<T> aligned_copy;
+    if (count > 0 && reinterpret_cast<uintptr_t>(values) % alignof(T) != 0)
+    {
+        aligned_copy.resize(count);
+        std::memcpy(aligned_copy.data(), input.data(), input_sz);
+        values = aligned_copy.data();
+    }
+    alp_writer out{output.data()};
+    out.put(input_sz);
+    for (size_t group = 0; group < count; group += alp_vector_size * alp_row_group_vectors)
+    {
+        size_t group_count = std::min(alp_vector_size * alp_row_group_vectors, count - group);
+        alp_row_group_plan<T> plan(values + group, group_count);
+        out.put(uint8_t(plan.scheme));
+        if (plan.scheme == alp_real)
+        {
+            out.put(uint8_t(plan.right_bits));
+            out.put(uint8_t(plan.dictionary.size()));
+            for (uint16_t left : plan.dictionary)
+                out.put(left);
+        }
+        for (size_t v = 0; v < group_count; v += alp_vector_size)
+            alp_encode_vector<T>(plan, values + group + v, std::min(alp_vector_size, group_count - v), out);
+    }
+    return out.p - output.data();
+}
+
+template <typename T> size_t Alp<T>::decoded_size(std::span<const std::byte> input)
+{
+    if (input.size() < sizeof(size_t))
+        throw std::runtime_error("Truncated ALP input");
+    size_t result_sz;
+    std::memcpy(&result_sz, input.data(), sizeof(size_t));
+    return result_sz;
+}
+
+template <typename T> size_t Alp<T>::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t result_sz = decoded_size(input);
+    if (output.size() < result_sz)
+        return result_sz;
+    if (result_sz % sizeof(T) != 0)
+        throw std::runtime_error("Corrupt ALP input");
+
+    size_t count = result_sz / sizeof(T);
+    alp_reader in{input.data() + sizeof(size_t), input.data() + input.size()};
+    std::vector<uint16_t> dictionary;
+    for (size_t group = 0; group < count; group += alp_vector_size * alp_row_group_vectors)
+    {
+        size_t group_count = std::min(alp_vector_size * alp_row_group_vectors, count - group);
+        auto scheme = alp_scheme(in.get<uint8_t>());
+        unsigned right_bits = 0;
+        dictionary.clear();
+        if (scheme == alp_real)
+        {
+            right_bits = in.get<uint8_t>();
+            size_t entries = in.get<uint8_t>();
+            if (right_bits < sizeof(T) * 8 - alp_rd_max_left_bits || right_bits >= sizeof(T) * 8 ||
+                entries == 0 || entries > alp_rd_dictionary_size)
+                throw std::runtime_error("Corrupt ALP_rd row group");
+            for (size_t i = 0; i < entries; i++)
+                dictionary.push_back(in.get<uint16_t>());
+        }
+        else if (scheme != alp_decimal)
+            throw std::runtime_error("Corrupt ALP row group");
+        for (size_t v = 0; v < group_count; v += alp_vector_size)
+            alp_decode_vector<T>(scheme, right_bits, dictionary, in, std::min(alp_vector_size, group_count - v),
+                                 output.data() + (group + v) * sizeof(T));
+    }
+    return result_sz;
+}
+template class Alp<float>;
+template class Alp<double>;
\ No newline at end of file
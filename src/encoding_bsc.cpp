@@ -1,53 +1,138 @@
 #include "encoding.hpp"
+#include "thread_pool.hpp"
+#include <climits>
 #include <cstddef>
 #include <libbsc.h>
+#include <mutex>
+#include <omp.h>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #define BSC_FEATURES (LIBBSC_FEATURE_FASTMODE)
 
-bool bsc_initialised = false;
+static std::once_flag bsc_initialised;
 
-void init_bsc()
+static void init_bsc()
 {
-    if (!bsc_initialised)
-    {
-        bsc_init(BSC_FEATURES);
-        bsc_initialised = true;
-    }
+    std::call_once(bsc_initialised, []() { bsc_init(BSC_FEATURES); });
+}
+
+Bsc::Bsc() : Bsc(bsc_params())
+{
+}
+
+Bsc::Bsc(bsc_params params) : params(params)
+{
+    int sorter = params.block_sorter;
+    if (sorter != LIBBSC_BLOCKSORTER_BWT && (sorter < LIBBSC_BLOCKSORTER_ST3 || sorter > LIBBSC_BLOCKSORTER_ST8))
+        throw std::runtime_error("Bsc block sorter " + std::to_string(params.block_sorter) + " is not 1 or 3 to 8");
+    if (params.coder < LIBBSC_CODER_QLFC_STATIC || params.coder > LIBBSC_CODER_QLFC_FAST)
+        throw std::runtime_error("Bsc coder " + std::to_string(params.coder) + " is not 1, 2 or 3");
+    bool lzp = params.lzp_hash_size || params.lzp_min_len;
+    if (lzp && (params.lzp_hash_size < 10 || params.lzp_hash_size > 28))
+        throw std::runtime_error("Bsc LZP hash size " + std::to_string(params.lzp_hash_size) + " is outside [10, 28]");
+    if (lzp && (params.lzp_min_len < 4 || params.lzp_min_len > 255))
+        throw std::runtime_error("Bsc LZP min length " + std::to_string(params.lzp_min_len) + " is outside [4, 255]");
 }
 
-std::span<const std::byte> Bsc::encode(std::span<const std::byte> input)
+// libbsc only uses OpenMP when it is built with it, which CMakeLists.txt does
+int Bsc::features() const
+{
+    return BSC_FEATURES | (params.multithreaded ? LIBBSC_FEATURE_MULTITHREADING : 0);
+}
+
+// OpenMP would start a team of one thread per core for every --jobs thread, the thread count set here only applies to
+// parallel regions started from the calling thread
+static void limit_bsc_threads(int features)
+{
+    if (features & LIBBSC_FEATURE_MULTITHREADING)
+        omp_set_num_threads(int(threads_per_job()));
+}
+
+std::string Bsc::name()
+{
+    static const char *coders[] = {"", "static", "adaptive", "fast"};
+    // no commas, names go into csv files
+    std::string options;
+    auto add = [&](const std::string &option) { options += (options.empty() ? "" : " ") + option; };
+    if (params.block_sorter != LIBBSC_BLOCKSORTER_BWT)
+        add("st" + std::to_string(params.block_sorter));
+    if (params.coder != LIBBSC_CODER_QLFC_FAST)
+        add(coders[params.coder]);
+    if (params.lzp_hash_size)
+        add("lzp " + std::to_string(params.lzp_hash_size) + " " + std::to_string(params.lzp_min_len));
+    if (params.multithreaded)
+        add("mt");
+    return options.empty() ? "Bsc" : "Bsc (" + options + ")";
+}
+
+size_t Bsc::max_encoded_size(size_t input_size)
+{
+    return LIBBSC_HEADER_SIZE + input_size;
+}
+
+size_t Bsc::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     init_bsc();
 
-    compressed_buffer = std::vector<std::byte>(LIBBSC_HEADER_SIZE + input.size_bytes());
+    // bsc needs room for incompressible input regardless of how well it compresses
+    size_t needed = max_encoded_size(input.size_bytes());
+    if (output.size() < needed)
+        return needed;
+    if (input.size_bytes() > INT_MAX - LIBBSC_HEADER_SIZE)
+        throw std::runtime_error("bsc blocks are limited to 2 GiB, use Chunked<Bsc> for larger inputs");
     auto input_ptr = reinterpret_cast<const unsigned char *>(input.data());
-    auto output_ptr = reinterpret_cast<unsigned char *>(compressed_buffer.data());
-    auto compressed_sz = bsc_compress(input_ptr, output_ptr, input.size_bytes(), 0, 0, LIBBSC_DEFAULT_BLOCKSORTER,
-                                      LIBBSC_CODER_QLFC_FAST, BSC_FEATURES);
+    auto output_ptr = reinterpret_cast<unsigned char *>(output.data());
+    limit_bsc_threads(features());
+    auto compressed_sz = bsc_compress(input_ptr, output_ptr, input.size_bytes(), params.lzp_hash_size,
+                                      params.lzp_min_len, params.block_sorter, params.coder, features());
     if (compressed_sz < 0)
     {
         throw std::runtime_error("bsc compression failed with " + std::to_string(compressed_sz));
     }
-    compressed_buffer.resize(compressed_sz);
-    return compressed_buffer;
+    return compressed_sz;
+}
+
+// the block and data sizes from a bsc header, checked against the input they came with
+static void read_bsc_header(std::span<const std::byte> input, int &block_size, int &block_data_size)
+{
+    if (input.size() < LIBBSC_HEADER_SIZE)
+        throw std::runtime_error("Truncated bsc input");
+    auto input_ptr = reinterpret_cast<const unsigned char *>(input.data());
+    auto err = bsc_block_info(input_ptr, LIBBSC_HEADER_SIZE, &block_size, &block_data_size, BSC_FEATURES);
+    if (err < 0)
+        throw std::runtime_error("Corrupt bsc input, header error " + std::to_string(err));
+    if (block_size < LIBBSC_HEADER_SIZE || block_data_size < 0)
+        throw std::runtime_error("Corrupt bsc input");
+    if (static_cast<size_t>(block_size) > input.size())
+        throw std::runtime_error("Truncated bsc input");
+}
+
+size_t Bsc::decoded_size(std::span<const std::byte> input)
+{
+    init_bsc();
+
+    int block_size, block_data_size;
+    read_bsc_header(input, block_size, block_data_size);
+    return block_data_size;
 }
 
-std::span<const std::byte> Bsc::decode(std::span<const std::byte> input)
+size_t Bsc::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     init_bsc();
 
     int block_size, block_data_size;
+    read_bsc_header(input, block_size, block_data_size);
+    if (output.size() < static_cast<size_t>(block_data_size))
+        return block_data_size;
+    limit_bsc_threads(features());
     auto input_ptr = reinterpret_cast<const unsigned char *>(input.data());
-    bsc_block_info(input_ptr, LIBBSC_HEADER_SIZE, &block_size, &block_data_size, BSC_FEATURES);
-    decompressed_buffer = std::vector<std::byte>(block_data_size);
-    auto err = bsc_decompress(input_ptr, block_size, reinterpret_cast<unsigned char *>(decompressed_buffer.data()),
-                              block_data_size, BSC_FEATURES);
+    auto err = bsc_decompress(input_ptr, block_size, reinterpret_cast<unsigned char *>(output.data()),
+                              block_data_size, features());
     if (err < 0)
     {
         throw std::runtime_error("bsc decompression failed with " + std::to_string(err));
     }
-    return decompressed_buffer;
+    return block_data_size;
 }
\ No newline at end of file
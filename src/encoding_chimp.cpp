@@ -0,0 +1,249 @@
+#include "encoding.hpp"
+#include "gorilla.hpp"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+template <typename T> using chimp_uint = std::conditional_t<sizeof(T) == 4, UInt32, UInt64>;
+
+// leading zero counts are rounded down to one of these and stored as the 3-bit index
+constexpr unsigned chimp_leading[8] = {0, 8, 12, 16, 18, 20, 22, 24};
+
+// the index of the rounded value for each count of leading zeros
+constexpr auto chimp_leading_index = [] {
+    std::array<UInt8, 65> index{};
+    for (unsigned zeros = 0, i = 0; zeros <= 64; zeros++)
+    {
+        while (i < 7 && chimp_leading[i + 1] <= zeros)
+            i++;
+        index[zeros] = i;
+    }
+    return index;
+}();
+
+// The layout of the codes, after the first value, which is stored as it is:
+//   00 [index]                                    same as the reference value
+//   01 [index] leading, significant bits, bits    XOR with the reference without its trailing zeros
+//   10 bits                                       XOR with the previous value, same leading zeros as last time
+//   11 leading, bits                              XOR with the previous value
+// The index of the reference among the last References values is only there for Chimp128.
+template <typename U, unsigned References> struct chimp_format
+{
+    static constexpr unsigned bit_size = sizeof(U) * 8;
+    static constexpr unsigned index_bits = std::countr_zero(References);
+    static constexpr unsigned significant_bits = sizeof(U) == 4 ? 5 : 6;
+    // a reference is only worth an index and the longer header when it leaves more trailing zeros than this
+    static constexpr unsigned threshold = significant_bits + index_bits;
+    static constexpr unsigned hash_bits = threshold + 1;
+    static constexpr unsigned trailing_header_bits = 2 + index_bits + 3 + significant_bits;
+    static constexpr unsigned max_bits = trailing_header_bits + bit_size;
+};
+
+template <typename U, unsigned References> static size_t chimp_encode(const char *source, size_t count, char *dest)
+{
+    typedef chimp_format<U, References> f;
+    if (count == 0)
+        return 0;
+
+    U ring[References];
+    ring[0] = unalignedLoadLittleEndian<U>(source);
+    unalignedStoreLittleEndian<U>(dest, ring[0]);
+    BitSink writer(dest + sizeof(U));
+    // for each hash of the low bits, the index of the last value that had it
+    std::vector<size_t> last_index(References > 1 ? size_t(1) << f::hash_bits : 0);
+    constexpr unsigned no_leading = f::bit_size + 1;
+    unsigned stored_leading = no_leading;
+
+    for (size_t i = 1; i < count; i++)
+    {
+        const U value = unalignedLoadLittleEndian<U>(source + i * sizeof(U));
+        unsigned reference = (i - 1) % References;
+        U xored = ring[reference] ^ value;
+        if constexpr (References > 1)
+        {
+            size_t &candidate = last_index[value & ((U(1) << f::hash_bits) - 1)];
+            if (i - candidate <= References)
+            {
+                const U candidate_xored = ring[candidate % References] ^ value;
+                if (unsigned(std::countr_zero(candidate_xored)) > f::threshold)
+                {
+                    reference = candidate % References;
+                    xored = candidate_xored;
+                }
+            }
+            candidate = i;
+        }
+        ring[i % References] = value;
+
+        if (xored == 0)
+        {
+            writer.write(reference, 2 + f::index_bits);
+            stored_leading = no_leading;
+            continue;
+        }
+        const unsigned index = chimp_leading_index[std::countl_zero(xored)];
+        const unsigned leading = chimp_leading[index];
+        const unsigned trailing = std::countr_zero(xored);
+        if (trailing > f::threshold)
+        {
+            const unsigned significant = f::bit_size - leading - trailing;
+            const UInt64 header = (((((0b01u << f::index_bits) | reference) << 3) | index) << f::significant_bits) |
+                                  significant;
+            writer.writeValue<f::bit_size>(header, f::trailing_header_bits, xored >> trailing, significant);
+            stored_leading = no_leading;
+        }
+        else if (leading == stored_leading)
+            writer.writeValue<f::bit_size>(0b10, 2, xored, f::bit_size - leading);
+        else
+        {
+            writer.writeValue<f::bit_size>((0b11 << 3) | index, 5, xored, f::bit_size - leading);
+            stored_leading = leading;
+        }
+    }
+    return sizeof(U) + writer.size();
+}
+
+template <typename U, unsigned References>
+static void chimp_decode(const char *source, size_t source_size, char *dest, size_t count)
+{
+    typedef chimp_format<U, References> f;
+    if (count == 0)
+        return;
+    if (source_size < sizeof(U))
+        throw std::runtime_error("Truncated Chimp input");
+
+    U ring[References]{}; // corrupt input can refer to slots no value has filled yet
+    ring[0] = unalignedLoadLittleEndian<U>(source);
+    unalignedStoreLittleEndian<U>(dest, ring[0]);
+    size_t i = 1;
+    unsigned stored_leading = 0;
+    bool have_leading = false, corrupted = false;
+
+    // The code of each value is read from a window loaded at its bit position, as in Gorilla's decoder; codes that
+    // cannot come from the encoder are noted and reported after the loop.
+    auto decode = [&](const char *data, UInt64 pos, UInt64 limit) ALWAYS_INLINE
+    {
+        // locals, since the stores through dest could otherwise alias the captured state
+        size_t n = i;
+        unsigned leading_zeros = stored_leading;
+        bool have = have_leading, bad = false;
+        for (; n < count && pos < limit; n++)
+        {
+            UInt64 window = peekBits57(data, pos);
+            const unsigned flag = window >> 62;
+            U value;
+            if (flag == 0b00)
+            {
+                value = ring[(window >> (62 - f::index_bits)) & (References - 1)];
+                pos += 2 + f::index_bits;
+                have = false;
+            }
+            else if (flag == 0b01)
+            {
+                const U reference = ring[(window >> (62 - f::index_bits)) & (References - 1)];
+                const unsigned leading = chimp_leading[(window >> (59 - f::index_bits)) & 7];
+                const unsigned significant =
+                    (window >> (59 - f::index_bits - f::significant_bits)) & ((1u << f::significant_bits) - 1);
+                bad |= (significant == 0) | (leading + significant > f::bit_size);
+                pos += f::trailing_header_bits;
+                window = sizeof(U) == 4 ? window << f::trailing_header_bits : peekBits64(data, pos);
+                const UInt64 bits = (window >> ((64 - significant) & 63)) & -UInt64(significant != 0);
+                const unsigned trailing = (f::bit_size - leading - significant) & (f::bit_size - 1);
+                value = reference ^ (static_cast<U>(bits) << trailing);
+                pos += significant;
+                have = false;
+            }
+            else
+            {
+                if (flag == 0b11)
+                {
+                    leading_zeros = chimp_leading[(window >> 59) & 7];
+                    have = true;
+                    pos += 5;
+                    window <<= 5;
+                }
+                else
+                {
+                    bad |= !have;
+                    pos += 2;
+                    window <<= 2;
+                }
+                if constexpr (sizeof(U) == 8)
+                    window = peekBits64(data, pos);
+                const unsigned bits = f::bit_size - leading_zeros;
+                value = ring[(n - 1) % References] ^ static_cast<U>(window >> (64 - bits));
+                pos += bits;
+            }
+            ring[n % References] = value;
+            unalignedStoreLittleEndian<U>(dest + n * sizeof(U), value);
+        }
+        i = n;
+        stored_leading = leading_zeros;
+        have_leading = have;
+        corrupted |= bad;
+        return pos;
+    };
+
+    const UInt64 bytes = source_size - sizeof(U);
+    const UInt64 pos = decodeBitstream(source + sizeof(U), bytes, decode);
+    if (corrupted || i < count || pos > bytes * 8)
+        throw std::runtime_error("Corrupt Chimp input");
+}
+
+template <typename T, unsigned References> size_t ChimpN<T, References>::max_encoded_size(size_t input_size)
+{
+    size_t values = input_size / sizeof(T);
+    if (values == 0)
+        return sizeof(size_t);
+    return sizeof(size_t) + sizeof(T) + (values - 1) * chimp_format<chimp_uint<T>, References>::max_bits / 8 + 1 +
+           gorilla_slack;
+}
+
+template <typename T, unsigned References>
+size_t ChimpN<T, References>::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t input_sz = input.size_bytes();
+    if (input_sz % sizeof(T) != 0)
+        throw std::runtime_error(string_format("Chimp input size %zu is not a multiple of %zu", input_sz, sizeof(T)));
+    // the bit writer does not check for room, so insist on the worst case up front
+    size_t needed = max_encoded_size(input_sz);
+    if (output.size() < needed)
+        return needed;
+    std::memcpy(output.data(), &input_sz, sizeof(size_t));
+    return sizeof(size_t) + chimp_encode<chimp_uint<T>, References>(reinterpret_cast<const char *>(input.data()),
+                                                                      input_sz / sizeof(T),
+                                                                      reinterpret_cast<char *>(output.data()) +
+                                                                          sizeof(size_t));
+}
+
+template <typename T, unsigned References>
+size_t ChimpN<T, References>::decoded_size(std::span<const std::byte> input)
+{
+    if (input.size() < sizeof(size_t))
+        throw std::runtime_error("Truncated Chimp input");
+    size_t result_sz;
+    std::memcpy(&result_sz, input.data(), sizeof(size_t));
+    return result_sz;
+}
+
+template <typename T, unsigned References>
+size_t ChimpN<T, References>::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t result_sz = decoded_size(input);
+    if (output.size() < result_sz)
+        return result_sz;
+    if (result_sz % sizeof(T) != 0)
+        throw std::runtime_error("Corrupt Chimp input");
+    chimp_decode<chimp_uint<T>, References>(reinterpret_cast<const char *>(input.data()) + sizeof(size_t),
+                                            input.size() - sizeof(size_t), reinterpret_cast<char *>(output.data()),
+                                            result_sz / sizeof(T));
+    return result_sz;
+}
+template class ChimpN<float, 1>;
+template class ChimpN<double, 1>;
+template class ChimpN<float, 128>;
+template class ChimpN<double, 128>;
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "encoding.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// The hashes keep the high bits of each value and each difference, which carry the sign, the exponent and the leading
+// mantissa bits. A zero byte count is stored as a 3-bit code; for double, which has 9 counts, 4 is stored as 3.
+template <typename T> struct fpc_traits;
+template <> struct fpc_traits<double>
+{
+    typedef uint64_t uint_type;
+    static constexpr unsigned fcm_shift = 6, fcm_value_shift = 48;
+    static constexpr unsigned dfcm_shift = 2, dfcm_value_shift = 40;
+    static constexpr unsigned code_of_zero_bytes[9] = {0, 1, 2, 3, 3, 4, 5, 6, 7};
+    static constexpr unsigned stored_bytes[8] = {8, 7, 6, 5, 3, 2, 1, 0};
+    static constexpr unsigned max_code = 7;
+};
+template <> struct fpc_traits<float>
+{
+    typedef uint32_t uint_type;
+    static constexpr unsigned fcm_shift = 5, fcm_value_shift = 16;
+    static constexpr unsigned dfcm_shift = 2, dfcm_value_shift = 12;
+    static constexpr unsigned code_of_zero_bytes[5] = {0, 1, 2, 3, 4};
+    static constexpr unsigned stored_bytes[8] = {4, 3, 2, 1, 0, 0, 0, 0};
+    static constexpr unsigned max_code = 4;
+};
+
+// a pair is a header byte and at most two whole values
+template <typename T> constexpr size_t fpc_max_pair_size = 1 + 2 * sizeof(T);
+constexpr size_t fpc_header_size = sizeof(size_t) + 1;
+
+// tables larger than the input would mostly stay empty, and clearing them would dominate short inputs
+static unsigned fpc_useful_table_bits(size_t count)
+{
+    return std::max(1, int(std::bit_width(count)));
+}
+
+template <typename T> class fpc_predictor
+{
+    typedef fpc_traits<T> t;
+    typedef typename t::uint_type U;
+
+    std::vector<U> tables;
+    U *fcm, *dfcm;
+    size_t mask;
+    size_t fcm_hash = 0, dfcm_hash = 0;
+    U last = 0;
+
+  public:
+    explicit fpc_predictor(unsigned table_bits)
+        : tables(size_t(2) << table_bits), fcm(tables.data()), dfcm(tables.data() + (size_t(1) << table_bits)),
+          mask((size_t(1) << table_bits) - 1)
+    {
+    }
+
+    U fcm_prediction() const
+    {
+        return fcm[fcm_hash];
+    }
+    U dfcm_prediction() const
+    {
+        return dfcm[dfcm_hash] + last;
+    }
+    void update(U value)
+    {
+        U delta = value - last;
+        fcm[fcm_hash] = value;
+        fcm_hash = ((fcm_hash << t::fcm_shift) ^ size_t(value >> t::fcm_value_shift)) & mask;
+        dfcm[dfcm_hash] = delta;
+        dfcm_hash = ((dfcm_hash << t::dfcm_shift) ^ size_t(delta >> t::dfcm_value_shift)) & mask;
+        last = value;
+    }
+
+    // the 4-bit code for value, the predictor in the high bit and the zero byte count below it, and its residual
+    unsigned encode(U value, U &residual)
+    {
+        U from_fcm = value ^ fcm_prediction(), from_dfcm = value ^ dfcm_prediction();
+        update(value);
+        unsigned selector = from_dfcm < from_fcm;
+        residual = selector ? from_dfcm : from_fcm;
+        return selector << 3 | t::code_of_zero_bytes[std::countl_zero(residual) / 8];
+    }
+    U decode(unsigned code, U residual)
+    {
+        U value = residual ^ (code >> 3 ? dfcm_prediction() : fcm_prediction());
+        update(value);
+        return value;
+    }
+};
+
+template <typename T> Fpc<T>::Fpc(unsigned table_bits) : table_bits(table_bits)
+{
+    if (table_bits == 0 || table_bits > max_table_bits)
+        throw std::runtime_error("FPC table size must be 2^1 to 2^" + std::to_string(max_table_bits) + " entries");
+}
+
+template <typename T> size_t Fpc<T>::max_encoded_size(size_t input_size)
+{
+    size_t pairs = (input_size / sizeof(T) + 1) / 2;
+    return fpc_header_size + pairs * fpc_max_pair_size<T>;
+}
+
+template <typename T> size_t Fpc<T>::decoded_size(std::span<const std::byte> input)
+{
+    if (input.size() < fpc_header_size)
+        throw std::runtime_error("Truncated FPC input");
+    size_t result_sz;
+    std::memcpy(&result_sz, input.data(), sizeof(size_t));
+    return result_sz;
+}
+
+template <typename T> size_t Fpc<T>::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    typedef typename fpc_traits<T>::uint_type U;
+    size_t input_sz = input.size_bytes();
+    if (input_sz % sizeof(T) != 0)
+        throw std::runtime_error("FPC input size is not a multiple of the value size");
+    size_t needed = max_encoded_size(input_sz);
+    if (output.size() < needed)
+        return needed;
+
+    size_t count = input_sz / sizeof(T);
+    unsigned bits = std::min(table_bits, fpc_useful_table_bits(count));
+    std::memcpy(output.data(), &input_sz, sizeof(size_t));
+    output[sizeof(size_t)] = std::byte(bits);
+    fpc_predictor<T> predictor(bits);
+    const std::byte *in = input.data();
+    std::byte *out = output.data() + fpc_header_size;
+    // residuals are written whole and the output advanced past their non-zero bytes only, which stays within the
+    // worst case of every pair so far
+    for (size_t i = 0; i < count; i += 2)
+    {
+        U first, second = 0, first_residual, second_residual = 0;
+        std::memcpy(&first, in + i * sizeof(T), sizeof(T));
+        unsigned first_code = predictor.encode(first, first_residual);
+        unsigned second_code = fpc_traits<T>::max_code;
+        if (i + 1 < count)
+        {
+            std::memcpy(&second, in + (i + 1) * sizeof(T), sizeof(T));
+            second_code = predictor.encode(second, second_residual);
+        }
+        *out++ = std::byte(first_code << 4 | second_code);
+        std::memcpy(out, &first_residual, sizeof(T));
+        out += fpc_traits<T>::stored_bytes[first_code & 7];
+        std::memcpy(out, &second_residual, sizeof(T));
+        out += fpc_traits<T>::stored_bytes[second_code & 7];
+    }
+    return out - output.data();
+}
+
+template <typename T> size_t Fpc<T>::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    typedef fpc_traits<T> t;
+    typedef typename t::uint_type U;
+    size_t result_sz = decoded_size(input);
+    if (output.size() < result_sz)
+        return result_sz;
+    size_t count = result_sz / sizeof(T);
+    unsigned bits = unsigned(input[sizeof(size_t)]);
+    if (result_sz % sizeof(T) != 0 || bits == 0 || bits > std::min(max_table_bits, fpc_useful_table_bits(count)))
+        throw std::runtime_error("Corrupt FPC input");
+    fpc_predictor<T> predictor(bits);
+    const std::byte *in = input.data() + fpc_header_size, *end = input.data() + input.size();
+    std::byte *out = output.data();
+    // the last few pairs are read from a zero padded copy, so whole residuals can always be loaded
+    std::byte tail[2 * fpc_max_pair_size<T>] = {};
+    bool in_tail = false;
+    auto residual = [&](unsigned code) {
+        if (code > t::max_code)
+            throw std::runtime_error("Corrupt FPC input");
+        U value;
+        std::memcpy(&value, in, sizeof(T));
+        unsigned bytes = t::stored_bytes[code];
+        in += bytes;
+        return bytes == sizeof(T) ? value : value & ((U(1) << (bytes * 8)) - 1);
+    };
+    for (size_t i = 0; i < count; i += 2)
+    {
+        if (!in_tail && size_t(end - in) < fpc_max_pair_size<T>)
+        {
+            size_t left = end - in;
+            std::memcpy(tail, in, left);
+            in = tail;
+            end = tail + left;
+            in_tail = true;
+        }
+        if (in == end)
+            throw std::runtime_error("Truncated FPC input");
+        unsigned header = unsigned(*in++);
+        U value = predictor.decode(header >> 4, residual(header >> 4 & 7));
+        std::memcpy(out + i * sizeof(T), &value, sizeof(T));
+        if (i + 1 < count)
+        {
+            value = predictor.decode(header & 15, residual(header & 7));
+            std::memcpy(out + (i + 1) * sizeof(T), &value, sizeof(T));
+        }
+        if (in > end)
+            throw std::runtime_error("Truncated FPC input");
+    }
+    if (in != end)
+        throw std::runtime_error("Corrupt FPC input");
+    return result_sz;
+}
+template class Fpc<float>;
+template class Fpc<double>;
\ No newline at end of file
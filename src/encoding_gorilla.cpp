@@ -1,8 +1,11 @@
 #include "encoding.hpp"
 #include "gorilla.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
+#include <vector>
 
 template <typename F> struct types;
 template <> struct types<double>
@@ -14,33 +17,118 @@ template <> struct types<float>
     typedef UInt32 uint_type;
 };
 
-template <typename T> std::span<const std::byte> Gorilla<T>::encode(std::span<const std::byte> input)
+static size_t header_size(size_t blocks)
 {
-    if (input.size_bytes() > std::numeric_limits<UInt32>::max())
-    {
-        throw std::runtime_error("Input data too big");
-    }
-    size_t input_sz = input.size_bytes();
-    auto input_ptr = reinterpret_cast<const char *>(input.data());
-    compressed_buffer = std::vector<std::byte>(getCompressedDataSize<T>(input.size_bytes()) + sizeof(size_t));
-    auto output_ptr = reinterpret_cast<char *>(compressed_buffer.data());
-    *reinterpret_cast<size_t *>(output_ptr) = input_sz;
-    size_t output_sz = compressDataForType<typename types<T>::uint_type>(
-        input_ptr, input_sz, output_ptr + sizeof(size_t), compressed_buffer.size());
-    compressed_buffer.resize(output_sz + sizeof(size_t));
-    return compressed_buffer;
+    return (blocks + 4) * sizeof(size_t);
+}
+
+static size_t read_header(std::span<const std::byte> input, size_t i)
+{
+    if (input.size() < (i + 1) * sizeof(size_t))
+        throw std::runtime_error("Truncated Gorilla header");
+    size_t value;
+    std::memcpy(&value, input.data() + i * sizeof(size_t), sizeof(size_t));
+    return value;
 }
 
-template <typename T> std::span<const std::byte> Gorilla<T>::decode(std::span<const std::byte> input)
+// room compressDataForType needs for a block of count values
+template <typename T> static size_t slot_size(size_t count)
+{
+    typedef typename types<T>::uint_type U;
+    return sizeof(UInt32) + getCompressedDataSize<U>(count * sizeof(T)) + gorilla_slack;
+}
+
+template <typename T> Gorilla<T>::Gorilla(size_t block_values) : block_values(block_values)
+{
+    if (block_values == 0 || block_values > max_block_values)
+        throw std::runtime_error("Gorilla block length must be 1 to " + std::to_string(max_block_values) + " values");
+}
+
+template <typename T> size_t Gorilla<T>::max_encoded_size(size_t input_size)
+{
+    size_t values = input_size / sizeof(T);
+    size_t blocks = block_count(values);
+    if (blocks == 0)
+        return header_size(0);
+    return header_size(blocks) + (blocks - 1) * slot_size<T>(block_values) +
+           slot_size<T>(values - (blocks - 1) * block_values);
+}
+
+template <typename T> size_t Gorilla<T>::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     size_t input_sz = input.size_bytes();
+    if (input_sz % sizeof(T) != 0)
+        throw std::runtime_error(string_format("Gorilla input size %zu is not a multiple of %zu", input_sz, sizeof(T)));
+    // the bit writer throws rather than stopping short, so insist on the worst case up front
+    size_t needed = max_encoded_size(input_sz);
+    if (output.size() < needed)
+        return needed;
+
+    // every block is encoded into a worst-case slot, then the blocks are moved together
+    size_t values = input_sz / sizeof(T);
+    size_t blocks = block_count(values);
+    size_t start = header_size(blocks);
+    size_t slot = slot_size<T>(block_values);
     auto input_ptr = reinterpret_cast<const char *>(input.data());
-    size_t result_sz = *reinterpret_cast<const size_t *>(input_ptr);
-    decompressed_buffer = std::vector<std::byte>(result_sz);
-    auto output_ptr = reinterpret_cast<char *>(decompressed_buffer.data());
-    decompressDataForType<typename types<T>::uint_type>(input_ptr + sizeof(size_t), input_sz - sizeof(size_t),
-                                                        output_ptr, result_sz);
-    return decompressed_buffer;
+    auto output_ptr = reinterpret_cast<char *>(output.data());
+    std::vector<size_t> sizes(blocks);
+    ThreadPool::shared().run(blocks, [&](size_t i) {
+        size_t first = i * block_values;
+        size_t count = std::min(block_values, values - first);
+        sizes[i] = compressDataForType<typename types<T>::uint_type>(
+            input_ptr + first * sizeof(T), count * sizeof(T), output_ptr + start + i * slot, slot_size<T>(count));
+    });
+
+    size_t header[3] = {input_sz, block_values, blocks};
+    std::memcpy(output_ptr, header, sizeof(header));
+    size_t pos = 0;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        std::memcpy(output_ptr + (3 + i) * sizeof(size_t), &pos, sizeof(size_t));
+        // never past the end of the block's own slot, so the slots not yet moved stay intact
+        std::memmove(output_ptr + start + pos, output_ptr + start + i * slot, sizes[i]);
+        pos += sizes[i];
+    }
+    std::memcpy(output_ptr + (3 + blocks) * sizeof(size_t), &pos, sizeof(size_t));
+    return start + pos;
+}
+
+template <typename T> size_t Gorilla<T>::decoded_size(std::span<const std::byte> input)
+{
+    return read_header(input, 0);
+}
+
+template <typename T> size_t Gorilla<T>::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t result_sz = decoded_size(input);
+    if (output.size() < result_sz)
+        return result_sz;
+    size_t stored_block_values = read_header(input, 1);
+    size_t blocks = read_header(input, 2);
+    size_t values = result_sz / sizeof(T);
+    if (result_sz % sizeof(T) != 0 || stored_block_values == 0 || stored_block_values > max_block_values ||
+        blocks != (values + stored_block_values - 1) / stored_block_values)
+        throw std::runtime_error("Corrupt Gorilla header");
+    size_t start = header_size(blocks);
+    if (read_header(input, 3 + blocks) > input.size() - start)
+        throw std::runtime_error("Truncated Gorilla input");
+
+    auto data = reinterpret_cast<const char *>(input.data()) + start;
+    size_t data_sz = input.size() - start;
+    auto output_ptr = reinterpret_cast<char *>(output.data());
+    ThreadPool::shared().run(blocks, [&](size_t i) {
+        size_t begin = read_header(input, 3 + i), end = read_header(input, 4 + i);
+        size_t first = i * stored_block_values;
+        size_t count = std::min(stored_block_values, values - first);
+        // the bitstream returns early on a block too short for its first value, which would leave output unwritten
+        if (begin > end || end > data_sz || end - begin < sizeof(UInt32) + sizeof(T) ||
+            end - begin > std::numeric_limits<UInt32>::max() ||
+            unalignedLoadLittleEndian<UInt32>(data + begin) != count)
+            throw std::runtime_error("Corrupt Gorilla block");
+        decompressDataForType<typename types<T>::uint_type>(data + begin, end - begin, output_ptr + first * sizeof(T),
+                                                            count * sizeof(T));
+    });
+    return result_sz;
 }
 template class Gorilla<float>;
 template class Gorilla<double>;
\ No newline at end of file
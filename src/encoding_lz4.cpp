@@ -1,35 +1,202 @@
 #include "lz4.h"
+#include "lz4hc.h"
 #include "encoding.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
 #include <stdexcept>
+#include <string>
 
-std::span<const std::byte> Lz4::encode(std::span<const std::byte> input)
+struct Lz4::context
+{
+    LZ4_stream_t *fast = nullptr;
+    LZ4_streamHC_t *hc = nullptr;
+    LZ4_streamDecode_t *decode = nullptr;
+
+    ~context()
+    {
+        if (fast)
+            LZ4_freeStream(fast);
+        if (hc)
+            LZ4_freeStreamHC(hc);
+        if (decode)
+            LZ4_freeStreamDecode(decode);
+    }
+};
+
+// written to the stream as it is, so it has no padding whose bytes would be left undefined
+struct linked_header
+{
+    size_t input_size;
+    uint32_t block_size;
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(linked_header) == sizeof(size_t) + 2 * sizeof(uint32_t));
+
+Lz4::Lz4() : Lz4(lz4_params())
+{
+}
+
+Lz4::Lz4(lz4_params params) : params(params)
+{
+    if (params.acceleration < 1 || params.acceleration > 65537)
+        throw std::runtime_error("Lz4 acceleration " + std::to_string(params.acceleration) + " is outside [1, 65537]");
+    if (params.hc_level && (params.hc_level < LZ4HC_CLEVEL_MIN || params.hc_level > LZ4HC_CLEVEL_MAX))
+        throw std::runtime_error("Lz4 HC level " + std::to_string(params.hc_level) + " is outside [" +
+                                 std::to_string(LZ4HC_CLEVEL_MIN) + ", " + std::to_string(LZ4HC_CLEVEL_MAX) + "]");
+    if (params.hc_level && params.acceleration != 1)
+        throw std::runtime_error("Lz4 HC has no acceleration");
+    if (params.linked_block > LZ4_MAX_INPUT_SIZE)
+        throw std::runtime_error("Lz4 linked block size " + std::to_string(params.linked_block) + " is too large");
+}
+
+Lz4::~Lz4() = default;
+
+// The states are created once per thread. LZ4_resetStream_fast and LZ4_resetStreamHC_fast then only clear what the
+// previous call left behind, the public equivalent of the _extState_fastReset functions, which a shared liblz4 does
+// not export.
+Lz4::context &Lz4::get_context()
+{
+    context &ctx = contexts.get();
+    if (!ctx.decode)
+    {
+        if (params.hc_level)
+            ctx.hc = LZ4_createStreamHC();
+        else
+            ctx.fast = LZ4_createStream();
+        ctx.decode = LZ4_createStreamDecode();
+        if (!(ctx.fast || ctx.hc) || !ctx.decode)
+            throw std::bad_alloc();
+    }
+    return ctx;
+}
+
+std::string Lz4::name()
+{
+    // no commas, names go into csv files
+    std::string options;
+    if (params.hc_level)
+        options = std::to_string(params.hc_level);
+    if (params.acceleration > 1)
+        options = "fast " + std::to_string(params.acceleration);
+    if (params.linked_block)
+    {
+        size_t block = params.linked_block;
+        options += (options.empty() ? "linked " : " linked ") +
+                   (block % 1024 ? std::to_string(block) + "B" : std::to_string(block >> 10) + "KiB");
+    }
+    std::string name = params.hc_level ? "Lz4 HC" : "Lz4";
+    return options.empty() ? name : name + " (" + options + ")";
+}
+
+size_t Lz4::max_encoded_size(size_t input_size)
+{
+    if (!params.linked_block)
+        return LZ4_compressBound(input_size) + sizeof(size_t);
+    size_t full = input_size / params.linked_block, rest = input_size % params.linked_block;
+    return sizeof(linked_header) + full * (LZ4_compressBound(params.linked_block) + sizeof(int32_t)) +
+           (rest ? LZ4_compressBound(rest) + sizeof(int32_t) : 0);
+}
+
+size_t Lz4::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     size_t input_sz = input.size_bytes();
-    compressed_buffer = std::vector<std::byte>(LZ4_compressBound(input_sz) + sizeof(size_t));
-    auto input_ptr = reinterpret_cast<const char *>(input.data());
-    auto output_ptr = reinterpret_cast<char *>(compressed_buffer.data() + sizeof(size_t));
-    size_t compressed_sz = LZ4_compress_default(input_ptr, output_ptr, input_sz, compressed_buffer.size() - sizeof(size_t));
-    if (compressed_sz == 0)
+    size_t needed = max_encoded_size(input_sz);
+    // lz4 returns 0 both on error and when the output is too small, so only accept a worst case sized buffer
+    if (output.size() < needed)
+        return needed;
+    context &ctx = get_context();
+    if (params.hc_level)
+        LZ4_resetStreamHC_fast(ctx.hc, params.hc_level);
+    else
+        LZ4_resetStream_fast(ctx.fast);
+    auto compress = [&](std::span<const std::byte> src, std::byte *dst, size_t capacity) {
+        auto src_ptr = reinterpret_cast<const char *>(src.data());
+        auto dst_ptr = reinterpret_cast<char *>(dst);
+        int compressed_sz =
+            params.hc_level
+                ? LZ4_compress_HC_continue(ctx.hc, src_ptr, dst_ptr, src.size(), capacity)
+                : LZ4_compress_fast_continue(ctx.fast, src_ptr, dst_ptr, src.size(), capacity, params.acceleration);
+        if (compressed_sz <= 0 && !src.empty())
+            throw std::runtime_error("lz4 compression failed");
+        return size_t(compressed_sz);
+    };
+
+    if (!params.linked_block)
     {
-        throw std::runtime_error("lz4 compression failed");
+        size_t compressed_sz = compress(input, output.data() + sizeof(size_t), needed - sizeof(size_t));
+        std::memcpy(output.data(), &input_sz, sizeof(size_t));
+        return compressed_sz + sizeof(size_t);
     }
-    auto sz_span = std::as_bytes(std::span<size_t, 1>(&input_sz, 1));
-    std::copy(sz_span.begin(), sz_span.end(), compressed_buffer.begin());
-    compressed_buffer.resize(compressed_sz + sizeof(size_t));
-    return compressed_buffer;
+
+    // the earlier blocks stay in place in the input, so each block can match into the 64 KiB before it
+    size_t pos = sizeof(linked_header);
+    for (size_t offset = 0; offset < input_sz; offset += params.linked_block)
+    {
+        size_t len = std::min(params.linked_block, input_sz - offset);
+        int32_t compressed_sz = compress(input.subspan(offset, len), output.data() + pos + sizeof(int32_t),
+                                         output.size() - pos - sizeof(int32_t));
+        std::memcpy(output.data() + pos, &compressed_sz, sizeof(int32_t));
+        pos += sizeof(int32_t) + compressed_sz;
+    }
+    linked_header header = {input_sz, static_cast<uint32_t>(params.linked_block)};
+    std::memcpy(output.data(), &header, sizeof(header));
+    return pos;
 }
 
-std::span<const std::byte> Lz4::decode(std::span<const std::byte> input)
+size_t Lz4::decoded_size(std::span<const std::byte> input)
 {
-    size_t decompressed_sz = *reinterpret_cast<const size_t *>(input.data());
-    decompressed_buffer = std::vector<std::byte>(decompressed_sz);
-    auto input_ptr = reinterpret_cast<const char *>(input.data() + sizeof(size_t));
-    auto output_ptr = reinterpret_cast<char *>(decompressed_buffer.data());
-    size_t res = LZ4_decompress_safe(input_ptr, output_ptr, input.size() - sizeof(size_t), decompressed_buffer.size());
-    if (res < 0)
+    if (input.size() < sizeof(size_t))
+        throw std::runtime_error("Truncated lz4 input");
+    size_t decompressed_sz;
+    std::memcpy(&decompressed_sz, input.data(), sizeof(size_t));
+    return decompressed_sz;
+}
+
+size_t Lz4::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t decompressed_sz = decoded_size(input);
+    if (output.size() < decompressed_sz)
+        return decompressed_sz;
+    if (!params.linked_block)
+    {
+        auto input_ptr = reinterpret_cast<const char *>(input.data() + sizeof(size_t));
+        auto output_ptr = reinterpret_cast<char *>(output.data());
+        int res = LZ4_decompress_safe(input_ptr, output_ptr, input.size() - sizeof(size_t), decompressed_sz);
+        if (res < 0 || size_t(res) != decompressed_sz)
+        {
+            throw std::runtime_error("lz4 decompression failed");
+        }
+        return decompressed_sz;
+    }
+
+    linked_header header;
+    if (input.size() < sizeof(header))
+        throw std::runtime_error("Truncated lz4 input");
+    std::memcpy(&header, input.data(), sizeof(header));
+    if (header.block_size == 0)
+        throw std::runtime_error("Corrupt lz4 header");
+    // blocks are decoded next to each other into the output, where the earlier ones are the history the next refers to
+    LZ4_streamDecode_t *stream = get_context().decode;
+    LZ4_setStreamDecode(stream, nullptr, 0);
+    size_t pos = sizeof(header);
+    for (size_t offset = 0; offset < decompressed_sz; offset += header.block_size)
     {
-        throw std::runtime_error("lz4 decompression failed");
+        size_t len = std::min<size_t>(header.block_size, decompressed_sz - offset);
+        int32_t compressed_sz;
+        if (input.size() - pos < sizeof(int32_t))
+            throw std::runtime_error("Truncated lz4 input");
+        std::memcpy(&compressed_sz, input.data() + pos, sizeof(int32_t));
+        pos += sizeof(int32_t);
+        if (compressed_sz < 0 || size_t(compressed_sz) > input.size() - pos)
+            throw std::runtime_error("Truncated lz4 input");
+        int res = LZ4_decompress_safe_continue(stream, reinterpret_cast<const char *>(input.data() + pos),
+                                               reinterpret_cast<char *>(output.data() + offset), compressed_sz, len);
+        if (res < 0 || size_t(res) != len)
+            throw std::runtime_error("lz4 decompression failed");
+        pos += compressed_sz;
     }
-    return decompressed_buffer;
+    return decompressed_sz;
 }
\ No newline at end of file
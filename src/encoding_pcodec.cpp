@@ -1,7 +1,10 @@
 #include "encoding.hpp"
+#include <algorithm>
+#include <climits>
 #include <cstddef>
 #include <span>
 #include <stdexcept>
+#include <string>
 
 template <typename T, PcodecEncType P> unsigned char get_pco_type();
 template <> unsigned char get_pco_type<float, p_float>()
@@ -29,26 +32,78 @@ template <> unsigned char get_pco_type<double, p_uint>()
     return PCO_TYPE_U64;
 }
 
+template <typename T, PcodecEncType P> Pcodec<T, P>::Pcodec(unsigned level) : level(level)
+{
+    if (level > 12)
+        throw std::runtime_error("Pcodec level " + std::to_string(level) + " is outside [0, 12]");
+}
+
+template <typename T, PcodecEncType P> size_t Pcodec<T, P>::max_encoded_size(size_t input_size)
+{
+    // pcodec has no published bound; this covers incompressible input plus chunk metadata, and encode_into still
+    // reports the real size if it is ever exceeded
+    return input_size + input_size / 64 + 4096;
+}
+
 template <typename T, PcodecEncType P> std::span<const std::byte> Pcodec<T, P>::encode(std::span<const std::byte> input)
 {
-    if (enc_vec.raw_box)
-        pco_free_pcovec(&enc_vec);
-    if (pco_simpler_compress(input.data(), input.size_bytes() / sizeof(T), get_pco_type<T, P>(), 8, &enc_vec) !=
-        PcoError::PcoSuccess)
+    context &ctx = contexts.get();
+    if (ctx.enc_vec.raw_box)
+        pco_free_pcovec(&ctx.enc_vec);
+    // the FFI counts values in 32 bits, Chunked splits larger arrays
+    if (input.size_bytes() / sizeof(T) > UINT_MAX)
+        throw std::runtime_error("Pcodec input is too large for one stream, use Chunked<Pcodec>");
+    if (pco_simpler_compress(input.data(), input.size_bytes() / sizeof(T), get_pco_type<T, P>(), level,
+                             &ctx.enc_vec) != PcoError::PcoSuccess)
         throw std::runtime_error("Pcodec compression failed.");
-    return std::span<const std::byte>(reinterpret_cast<const std::byte *>(enc_vec.ptr), enc_vec.len);
+    return std::span<const std::byte>(reinterpret_cast<const std::byte *>(ctx.enc_vec.ptr), ctx.enc_vec.len);
 }
 
-template <typename T, PcodecEncType P> std::span<const std::byte> Pcodec<T, P>::decode(std::span<const std::byte> input)
+template <typename T, PcodecEncType P>
+size_t Pcodec<T, P>::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
-    if (dec_vec.raw_box)
-        pco_free_pcovec(&dec_vec);
-    if (pco_simple_decompress(input.data(), input.size_bytes(), get_pco_type<T, P>(), &dec_vec) != PcoError::PcoSuccess)
+    auto encoded = encode(input);
+    if (output.size() < encoded.size())
+        return encoded.size();
+    std::copy(encoded.begin(), encoded.end(), output.begin());
+    return encoded.size();
+}
+
+template <typename T, PcodecEncType P> void Pcodec<T, P>::decompress(context &ctx, std::span<const std::byte> input)
+{
+    if (ctx.dec_vec.raw_box)
+        pco_free_pcovec(&ctx.dec_vec);
+    if (pco_simple_decompress(input.data(), input.size_bytes(), get_pco_type<T, P>(), &ctx.dec_vec) !=
+        PcoError::PcoSuccess)
         throw std::runtime_error("Pcodec decompression failed.");
-    return std::span<const std::byte>(reinterpret_cast<const std::byte *>(dec_vec.ptr), dec_vec.len * sizeof(T));
 }
 
-template <typename T, PcodecEncType P> Pcodec<T, P>::~Pcodec()
+// the stream only gives its length once decompressed, decode and decode_into do not call this
+template <typename T, PcodecEncType P> size_t Pcodec<T, P>::decoded_size(std::span<const std::byte> input)
+{
+    context &ctx = contexts.get();
+    decompress(ctx, input);
+    return ctx.dec_vec.len * sizeof(T);
+}
+
+template <typename T, PcodecEncType P>
+size_t Pcodec<T, P>::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    auto decoded = decode(input);
+    if (output.size() < decoded.size())
+        return decoded.size();
+    std::copy(decoded.begin(), decoded.end(), output.begin());
+    return decoded.size();
+}
+
+template <typename T, PcodecEncType P> std::span<const std::byte> Pcodec<T, P>::decode(std::span<const std::byte> input)
+{
+    context &ctx = contexts.get();
+    decompress(ctx, input);
+    return std::span<const std::byte>(reinterpret_cast<const std::byte *>(ctx.dec_vec.ptr), ctx.dec_vec.len * sizeof(T));
+}
+
+template <typename T, PcodecEncType P> Pcodec<T, P>::context::~context()
 {
     if (dec_vec.raw_box)
         pco_free_pcovec(&dec_vec);
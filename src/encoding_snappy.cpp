@@ -3,27 +3,40 @@
 #include <snappy.h>
 #include <stdexcept>
 
-std::span<const std::byte> Snappy::encode(std::span<const std::byte> input)
+size_t Snappy::max_encoded_size(size_t input_size)
+{
+    return snappy::MaxCompressedLength(input_size);
+}
+
+size_t Snappy::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     size_t input_sz = input.size_bytes();
+    size_t needed = max_encoded_size(input_sz);
+    if (output.size() < needed)
+        return needed;
     auto input_ptr = reinterpret_cast<const char *>(input.data());
-    compressed_buffer = std::vector<std::byte>(snappy::MaxCompressedLength(input_sz));
-    auto output_ptr = reinterpret_cast<char *>(compressed_buffer.data());
+    auto output_ptr = reinterpret_cast<char *>(output.data());
     size_t output_sz;
     snappy::RawCompress(input_ptr, input_sz, output_ptr, &output_sz);
-    compressed_buffer.resize(output_sz);
-    return compressed_buffer;
+    return output_sz;
 }
 
-std::span<const std::byte> Snappy::decode(std::span<const std::byte> input)
+size_t Snappy::decoded_size(std::span<const std::byte> input)
 {
-    size_t input_sz = input.size_bytes();
-    auto input_ptr = reinterpret_cast<const char *>(input.data());
     size_t result;
-    if (!snappy::GetUncompressedLength(input_ptr, input_sz, &result))
+    if (!snappy::GetUncompressedLength(reinterpret_cast<const char *>(input.data()), input.size_bytes(), &result))
+        throw std::runtime_error("Snappy decompression failed.");
+    return result;
+}
+
+size_t Snappy::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t result = decoded_size(input);
+    if (output.size() < result)
+        return result;
+    auto input_ptr = reinterpret_cast<const char *>(input.data());
+    auto output_ptr = reinterpret_cast<char *>(output.data());
+    if (!snappy::RawUncompress(input_ptr, input.size_bytes(), output_ptr))
         throw std::runtime_error("Snappy decompression failed.");
-    decompressed_buffer = std::vector<std::byte>(result);
-    auto output_ptr = reinterpret_cast<char *>(decompressed_buffer.data());
-    snappy::RawUncompress(input_ptr, input_sz, output_ptr);
-    return decompressed_buffer;
+    return result;
 }
\ No newline at end of file
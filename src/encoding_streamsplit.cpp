@@ -7,62 +7,117 @@
 
 using namespace arrow::util::internal;
 
-template <typename T> std::vector<std::byte> streamsplit_enc(std::span<const std::byte> input)
+template <typename T> void streamsplit_enc_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     assert(input.size_bytes() % sizeof(T) == 0);
+    assert(output.size_bytes() >= input.size_bytes());
     size_t num_vals = input.size_bytes() / sizeof(T);
 
-    std::vector<std::byte> output_buffer = std::vector<std::byte>(input.size_bytes());
     ByteStreamSplitEncodeAvx2<T>(reinterpret_cast<const uint8_t *>(input.data()), num_vals,
-                                 reinterpret_cast<uint8_t *>(output_buffer.data()));
-    return output_buffer;
+                                 reinterpret_cast<uint8_t *>(output.data()));
 }
-template std::vector<std::byte> streamsplit_enc<double>(std::span<const std::byte> input);
-template std::vector<std::byte> streamsplit_enc<float>(std::span<const std::byte> input);
-template <typename T> std::vector<std::byte> streamsplit_dec(std::span<const std::byte> input)
+template <typename T> void streamsplit_dec_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     assert(input.size_bytes() % sizeof(T) == 0);
+    assert(output.size_bytes() >= input.size_bytes());
     size_t num_vals = input.size_bytes() / sizeof(T);
 
-    std::vector<std::byte> output_buffer = std::vector<std::byte>(input.size_bytes());
     ByteStreamSplitDecodeAvx2<T>(reinterpret_cast<const uint8_t *>(input.data()), num_vals, num_vals,
-                                 reinterpret_cast<T *>(output_buffer.data()));
-    return output_buffer;
+                                 reinterpret_cast<T *>(output.data()));
 }
-template std::vector<std::byte> streamsplit_dec<double>(std::span<const std::byte> input);
-template std::vector<std::byte> streamsplit_dec<float>(std::span<const std::byte> input);
 
-template <> std::vector<std::byte> streamsplit_enc<uint16_t>(std::span<const std::byte> input)
+template <> void streamsplit_enc_into<uint16_t>(std::span<const std::byte> input, std::span<std::byte> output)
 {
     assert(input.size_bytes() % sizeof(uint16_t) == 0);
+    assert(output.size_bytes() >= input.size_bytes());
     size_t num_vals = input.size_bytes() / sizeof(uint16_t);
 
-    std::vector<std::byte> output_buffer = std::vector<std::byte>(input.size_bytes());
     ByteStreamSplitEncodeScalar<uint16_t>(reinterpret_cast<const uint8_t *>(input.data()), num_vals,
-                                          reinterpret_cast<uint8_t *>(output_buffer.data()));
-    return output_buffer;
+                                          reinterpret_cast<uint8_t *>(output.data()));
 }
-template <> std::vector<std::byte> streamsplit_dec<uint16_t>(std::span<const std::byte> input)
+template <> void streamsplit_dec_into<uint16_t>(std::span<const std::byte> input, std::span<std::byte> output)
 {
     assert(input.size_bytes() % sizeof(uint16_t) == 0);
+    assert(output.size_bytes() >= input.size_bytes());
     size_t num_vals = input.size_bytes() / sizeof(uint16_t);
 
-    std::vector<std::byte> output_buffer = std::vector<std::byte>(input.size_bytes());
     ByteStreamSplitDecodeScalar<uint16_t>(reinterpret_cast<const uint8_t *>(input.data()), num_vals, num_vals,
-                                          reinterpret_cast<uint16_t *>(output_buffer.data()));
+                                          reinterpret_cast<uint16_t *>(output.data()));
+}
+template <typename T>
+void streamsplit_dec_range(std::span<const std::byte> input, size_t first, std::span<std::byte> output)
+{
+    size_t num_vals = input.size_bytes() / sizeof(T);
+    size_t count = output.size_bytes() / sizeof(T);
+    assert(first + count <= num_vals);
+
+    ByteStreamSplitDecodeAvx2<T>(reinterpret_cast<const uint8_t *>(input.data()) + first, count, num_vals,
+                                 reinterpret_cast<T *>(output.data()));
+}
+
+template <>
+void streamsplit_dec_range<uint16_t>(std::span<const std::byte> input, size_t first, std::span<std::byte> output)
+{
+    size_t num_vals = input.size_bytes() / sizeof(uint16_t);
+    size_t count = output.size_bytes() / sizeof(uint16_t);
+    assert(first + count <= num_vals);
+
+    // two planes, simple enough for the compiler to vectorise
+    auto low = reinterpret_cast<const uint8_t *>(input.data()) + first;
+    auto high = low + num_vals;
+    auto out = reinterpret_cast<uint16_t *>(output.data());
+    for (size_t i = 0; i < count; i++)
+        out[i] = low[i] | high[i] << 8;
+}
+
+template void streamsplit_enc_into<double>(std::span<const std::byte> input, std::span<std::byte> output);
+template void streamsplit_enc_into<float>(std::span<const std::byte> input, std::span<std::byte> output);
+template void streamsplit_dec_into<double>(std::span<const std::byte> input, std::span<std::byte> output);
+template void streamsplit_dec_into<float>(std::span<const std::byte> input, std::span<std::byte> output);
+
+template <typename T> std::vector<std::byte> streamsplit_enc(std::span<const std::byte> input)
+{
+    std::vector<std::byte> output_buffer(input.size_bytes());
+    streamsplit_enc_into<T>(input, output_buffer);
+    return output_buffer;
+}
+template std::vector<std::byte> streamsplit_enc<double>(std::span<const std::byte> input);
+template std::vector<std::byte> streamsplit_enc<float>(std::span<const std::byte> input);
+template std::vector<std::byte> streamsplit_enc<uint16_t>(std::span<const std::byte> input);
+template <typename T> std::vector<std::byte> streamsplit_dec(std::span<const std::byte> input)
+{
+    std::vector<std::byte> output_buffer(input.size_bytes());
+    streamsplit_dec_into<T>(input, output_buffer);
     return output_buffer;
 }
+template std::vector<std::byte> streamsplit_dec<double>(std::span<const std::byte> input);
+template std::vector<std::byte> streamsplit_dec<float>(std::span<const std::byte> input);
+template std::vector<std::byte> streamsplit_dec<uint16_t>(std::span<const std::byte> input);
+
+template <typename T> size_t StreamSplit<T>::max_encoded_size(size_t input_size)
+{
+    return input_size;
+}
+
+template <typename T> size_t StreamSplit<T>::decoded_size(std::span<const std::byte> input)
+{
+    return input.size_bytes();
+}
 
-template <typename T> std::span<const std::byte> StreamSplit<T>::encode(std::span<const std::byte> input)
+template <typename T> size_t StreamSplit<T>::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
-    encoded_buffer = streamsplit_enc<T>(input);
-    return encoded_buffer;
+    if (output.size() < input.size_bytes())
+        return input.size_bytes();
+    streamsplit_enc_into<T>(input, output);
+    return input.size_bytes();
 }
 
-template <typename T> std::span<const std::byte> StreamSplit<T>::decode(std::span<const std::byte> input)
+template <typename T> size_t StreamSplit<T>::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
-    decoded_buffer = streamsplit_dec<T>(input);
-    return decoded_buffer;
+    if (output.size() < input.size_bytes())
+        return input.size_bytes();
+    streamsplit_dec_into<T>(input, output);
+    return input.size_bytes();
 }
 template class StreamSplit<float>;
 template class StreamSplit<double>;
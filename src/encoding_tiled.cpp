@@ -0,0 +1,231 @@
+#include "encoding.hpp"
+#include "lz4.h"
+#include "zstd.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+
+constexpr uint32_t tiled_version = 1;
+
+struct tiled_header
+{
+    size_t input_size;
+    uint32_t version;
+    uint32_t tile_size;
+};
+
+template <typename T, typename B> struct TiledSplit<T, B>::context
+{
+    // two tiles, because lz4 streams refer back into the previous block
+    byte_buffer tiles[2];
+    ZSTD_CCtx *zstd_c = nullptr;
+    ZSTD_DCtx *zstd_d = nullptr;
+    LZ4_stream_t *lz4_c = nullptr;
+    LZ4_streamDecode_t *lz4_d = nullptr;
+
+    ~context()
+    {
+        ZSTD_freeCCtx(zstd_c);
+        ZSTD_freeDCtx(zstd_d);
+        if (lz4_c)
+            LZ4_freeStream(lz4_c);
+        if (lz4_d)
+            LZ4_freeStreamDecode(lz4_d);
+    }
+};
+
+template <typename T, typename B>
+TiledSplit<T, B>::TiledSplit(size_t tile_size) : tile_size((std::max<size_t>(tile_size, 1) + 63) / 64 * 64)
+{
+    static_assert(std::is_same_v<B, Zstd> || std::is_same_v<B, Lz4>, "TiledSplit needs a streaming backend");
+}
+
+template <typename T, typename B> TiledSplit<T, B>::~TiledSplit() = default;
+
+template <typename T, typename B> size_t TiledSplit<T, B>::default_tile_size()
+{
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return l2 > 0 ? size_t(l2) / 2 : size_t(512) << 10;
+}
+
+static tiled_header read_header(std::span<const std::byte> input)
+{
+    tiled_header header;
+    if (input.size() < sizeof(header))
+        throw std::runtime_error("Truncated tiled input");
+    std::memcpy(&header, input.data(), sizeof(header));
+    if (header.version != tiled_version)
+        throw std::runtime_error("Unsupported tiled format version " + std::to_string(header.version));
+    if (header.tile_size == 0)
+        throw std::runtime_error("Corrupt tiled header");
+    return header;
+}
+
+template <typename T, typename B> size_t TiledSplit<T, B>::max_encoded_size(size_t input_size)
+{
+    if constexpr (std::is_same_v<B, Zstd>)
+        return sizeof(tiled_header) + ZSTD_compressBound(input_size);
+    // each lz4 tile is a separate block behind its compressed size
+    size_t tiles = (input_size + tile_size - 1) / tile_size;
+    if (tiles == 0)
+        return sizeof(tiled_header);
+    size_t last = input_size - (tiles - 1) * tile_size;
+    return sizeof(tiled_header) + tiles * sizeof(int32_t) + (tiles - 1) * LZ4_compressBound(tile_size) +
+           LZ4_compressBound(last);
+}
+
+template <typename T, typename B> size_t TiledSplit<T, B>::decoded_size(std::span<const std::byte> input)
+{
+    return read_header(input).input_size;
+}
+
+template <typename T, typename B>
+size_t TiledSplit<T, B>::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t input_sz = input.size_bytes();
+    if (input_sz % sizeof(T) != 0)
+        throw std::runtime_error(name() + " needs whole values");
+    size_t needed = max_encoded_size(input_sz);
+    if (output.size() < sizeof(tiled_header))
+        return needed;
+
+    context &ctx = contexts.get();
+    for (auto &tile : ctx.tiles)
+        tile.resize(tile_size);
+    size_t pos = sizeof(tiled_header);
+
+    if constexpr (std::is_same_v<B, Zstd>)
+    {
+        if (!ctx.zstd_c)
+        {
+            ctx.zstd_c = ZSTD_createCCtx();
+            backend.configure(ctx.zstd_c);
+        }
+        ZSTD_CCtx_reset(ctx.zstd_c, ZSTD_reset_session_only);
+        ZSTD_CCtx_setPledgedSrcSize(ctx.zstd_c, input_sz);
+        ZSTD_outBuffer out = {output.data() + pos, output.size() - pos, 0};
+        size_t offset = 0;
+        do
+        {
+            size_t len = std::min(tile_size, input_sz - offset);
+            streamsplit_enc_into<T>(input.subspan(offset, len), ctx.tiles[0]);
+            offset += len;
+            ZSTD_inBuffer in = {ctx.tiles[0].data(), len, 0};
+            ZSTD_EndDirective mode = offset == input_sz ? ZSTD_e_end : ZSTD_e_continue;
+            size_t remaining;
+            do
+            {
+                remaining = ZSTD_compressStream2(ctx.zstd_c, &out, &in, mode);
+                if (ZSTD_isError(remaining))
+                    throw std::runtime_error("ZSTD compression failed");
+                if (out.pos == out.size && (in.pos < in.size || remaining != 0))
+                    return needed;
+            } while (mode == ZSTD_e_end ? remaining != 0 : in.pos < in.size);
+        } while (offset < input_sz);
+        pos += out.pos;
+    }
+    else
+    {
+        // lz4 only reports failure, not the size it needed, so only accept a worst case sized buffer
+        if (output.size() < needed)
+            return needed;
+        if (!ctx.lz4_c)
+            ctx.lz4_c = LZ4_createStream();
+        LZ4_resetStream_fast(ctx.lz4_c);
+        for (size_t offset = 0, t = 0; offset < input_sz; offset += tile_size, t++)
+        {
+            size_t len = std::min(tile_size, input_sz - offset);
+            auto &tile = ctx.tiles[t % 2];
+            streamsplit_enc_into<T>(input.subspan(offset, len), tile);
+            auto dst = reinterpret_cast<char *>(output.data() + pos + sizeof(int32_t));
+            int32_t compressed_sz =
+                LZ4_compress_fast_continue(ctx.lz4_c, reinterpret_cast<const char *>(tile.data()), dst, len,
+                                           output.size() - pos - sizeof(int32_t), 1);
+            if (compressed_sz <= 0)
+                throw std::runtime_error("lz4 compression failed");
+            std::memcpy(output.data() + pos, &compressed_sz, sizeof(int32_t));
+            pos += sizeof(int32_t) + compressed_sz;
+        }
+    }
+
+    tiled_header header = {input_sz, tiled_version, static_cast<uint32_t>(tile_size)};
+    std::memcpy(output.data(), &header, sizeof(header));
+    return pos;
+}
+
+template <typename T, typename B>
+size_t TiledSplit<T, B>::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    tiled_header header = read_header(input);
+    size_t output_sz = header.input_size;
+    if (output.size() < output_sz)
+        return output_sz;
+    size_t tile_sz = header.tile_size;
+    if (output_sz % sizeof(T) != 0 || tile_sz % sizeof(T) != 0)
+        throw std::runtime_error("Corrupt tiled header");
+
+    context &ctx = contexts.get();
+    for (auto &tile : ctx.tiles)
+        tile.resize(tile_sz);
+    size_t pos = sizeof(tiled_header);
+
+    if constexpr (std::is_same_v<B, Zstd>)
+    {
+        if (!ctx.zstd_d)
+        {
+            ctx.zstd_d = ZSTD_createDCtx();
+            backend.configure(ctx.zstd_d);
+        }
+        ZSTD_DCtx_reset(ctx.zstd_d, ZSTD_reset_session_only);
+        ZSTD_inBuffer in = {input.data() + pos, input.size() - pos, 0};
+        for (size_t offset = 0; offset < output_sz; offset += tile_sz)
+        {
+            size_t len = std::min(tile_sz, output_sz - offset);
+            ZSTD_outBuffer out = {ctx.tiles[0].data(), len, 0};
+            while (out.pos < out.size)
+            {
+                size_t in_pos = in.pos, out_pos = out.pos;
+                size_t res = ZSTD_decompressStream(ctx.zstd_d, &out, &in);
+                if (ZSTD_isError(res))
+                    throw std::runtime_error("ZSTD decompression failed");
+                if (in.pos == in_pos && out.pos == out_pos)
+                    throw std::runtime_error("Truncated tiled input");
+            }
+            streamsplit_dec_into<T>(std::span<const std::byte>(ctx.tiles[0]).first(len), output.subspan(offset, len));
+        }
+    }
+    else
+    {
+        if (!ctx.lz4_d)
+            ctx.lz4_d = LZ4_createStreamDecode();
+        LZ4_setStreamDecode(ctx.lz4_d, nullptr, 0);
+        for (size_t offset = 0, t = 0; offset < output_sz; offset += tile_sz, t++)
+        {
+            size_t len = std::min(tile_sz, output_sz - offset);
+            int32_t compressed_sz;
+            if (input.size() - pos < sizeof(int32_t))
+                throw std::runtime_error("Truncated tiled input");
+            std::memcpy(&compressed_sz, input.data() + pos, sizeof(int32_t));
+            pos += sizeof(int32_t);
+            if (compressed_sz < 0 || size_t(compressed_sz) > input.size() - pos)
+                throw std::runtime_error("Truncated tiled input");
+            auto &tile = ctx.tiles[t % 2];
+            int res = LZ4_decompress_safe_continue(ctx.lz4_d, reinterpret_cast<const char *>(input.data() + pos),
+                                                   reinterpret_cast<char *>(tile.data()), compressed_sz, len);
+            if (res < 0 || size_t(res) != len)
+                throw std::runtime_error("lz4 decompression failed");
+            pos += compressed_sz;
+            streamsplit_dec_into<T>(std::span<const std::byte>(tile).first(len), output.subspan(offset, len));
+        }
+    }
+    return output_sz;
+}
+
+template class TiledSplit<float, Zstd>;
+template class TiledSplit<float, Lz4>;
+template class TiledSplit<double, Zstd>;
+template class TiledSplit<double, Lz4>;
\ No newline at end of file
@@ -1,40 +1,311 @@
+#define ZSTD_STATIC_LINKING_ONLY // for ZSTD_c_literalCompressionMode and ZSTD_WINDOWLOG_LIMIT_DEFAULT
 #include "encoding.hpp"
+#include "thread_pool.hpp"
+#include "zdict.h"
 #include "zstd.h"
+#include "zstd_errors.h"
+#include <algorithm>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
-constexpr int level = 3;
+struct Zstd::context
+{
+    ZSTD_CCtx *cctx = nullptr;
+    ZSTD_DCtx *dctx = nullptr;
+
+    ~context()
+    {
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+    }
+};
+
+static void check_param(ZSTD_cParameter param, int value, const char *what)
+{
+    ZSTD_bounds bounds = ZSTD_cParam_getBounds(param);
+    if (value < bounds.lowerBound || value > bounds.upperBound)
+        throw std::runtime_error("Zstd " + std::string(what) + " " + std::to_string(value) + " is outside [" +
+                                 std::to_string(bounds.lowerBound) + ", " + std::to_string(bounds.upperBound) + "]");
+}
+
+static void set_param(ZSTD_CCtx *cctx, ZSTD_cParameter param, int value)
+{
+    size_t res = ZSTD_CCtx_setParameter(cctx, param, value);
+    if (ZSTD_isError(res))
+        throw std::runtime_error(std::string("ZSTD parameter rejected: ") + ZSTD_getErrorName(res));
+}
+
+ZstdDictionary::ZstdDictionary(std::vector<std::byte> content) : content(std::move(content))
+{
+    if (ZDICT_getDictID(this->content.data(), this->content.size()) == 0)
+        throw std::runtime_error("not a zstd dictionary");
+}
+
+ZstdDictionary ZstdDictionary::train(std::span<const std::byte> data, size_t block_size, size_t capacity)
+{
+    if (block_size == 0)
+        throw std::runtime_error("Zstd dictionary block size must not be zero");
+    // zstd suggests about 100 times the dictionary size in samples, more mostly slows training down
+    size_t block_count = data.size() / block_size;
+    size_t sample_count = std::min(block_count, std::max<size_t>(capacity * 100 / block_size, 1));
+    std::vector<std::byte> samples(sample_count * block_size);
+    for (size_t i = 0; i < sample_count; i++)
+        std::memcpy(samples.data() + i * block_size, data.data() + i * block_count / sample_count * block_size,
+                    block_size);
+    std::vector<size_t> sample_sizes(sample_count, block_size);
+
+    std::vector<std::byte> content(capacity);
+    size_t res = ZDICT_trainFromBuffer(content.data(), capacity, samples.data(), sample_sizes.data(), sample_count);
+    if (ZDICT_isError(res))
+        throw std::runtime_error(std::string("Zstd dictionary training failed: ") + ZDICT_getErrorName(res));
+    content.resize(res);
+    return ZstdDictionary(std::move(content));
+}
+
+ZstdDictionary ZstdDictionary::load(const std::string &path)
+{
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        throw std::runtime_error("cannot open dictionary " + path);
+    std::vector<std::byte> content;
+    std::byte chunk[1 << 16];
+    while (size_t n = std::fread(chunk, 1, sizeof(chunk), f))
+        content.insert(content.end(), chunk, chunk + n);
+    std::fclose(f);
+    return ZstdDictionary(std::move(content));
+}
+
+void ZstdDictionary::save(const std::string &path) const
+{
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("cannot create dictionary " + path);
+    bool ok = std::fwrite(content.data(), 1, content.size(), f) == content.size();
+    if (std::fclose(f) != 0 || !ok)
+        throw std::runtime_error("cannot write dictionary " + path);
+}
+
+Zstd::Zstd() : Zstd(zstd_params())
+{
+}
+
+Zstd::Zstd(zstd_params params) : Zstd(params, nullptr)
+{
+}
+
+Zstd::Zstd(zstd_params params, std::shared_ptr<const ZstdDictionary> dictionary)
+    : params(params), dictionary(std::move(dictionary))
+{
+    check_param(ZSTD_c_compressionLevel, params.level, "level");
+    if (params.strategy)
+        check_param(ZSTD_c_strategy, params.strategy, "strategy");
+    if (params.window_log)
+        check_param(ZSTD_c_windowLog, params.window_log, "window log");
+    if (params.hash_log)
+        check_param(ZSTD_c_hashLog, params.hash_log, "hash log");
+    if (params.literal_mode < ZSTD_ps_auto || params.literal_mode > ZSTD_ps_disable)
+        throw std::runtime_error("Zstd literal mode " + std::to_string(params.literal_mode) + " is not 0, 1 or 2");
+    // a libzstd built without multithreading reports [0, 0] here
+    if (params.workers > 0)
+        check_param(ZSTD_c_nbWorkers, params.workers, "worker count");
+    if (params.workers < 0)
+        check_param(ZSTD_c_nbWorkers, 1, "worker count");
+    if (params.job_size)
+        check_param(ZSTD_c_jobSize, params.job_size, "job size");
+    if (params.overlap_log)
+        check_param(ZSTD_c_overlapLog, params.overlap_log, "overlap log");
+    if (this->dictionary)
+    {
+        auto bytes = this->dictionary->bytes();
+        cdict = ZSTD_createCDict(bytes.data(), bytes.size(), params.level);
+        ddict = ZSTD_createDDict(bytes.data(), bytes.size());
+        if (!cdict || !ddict)
+        {
+            ZSTD_freeCDict(cdict);
+            ZSTD_freeDDict(ddict);
+            throw std::runtime_error("cannot digest Zstd dictionary");
+        }
+    }
+}
+
+int Zstd::worker_count() const
+{
+    if (params.workers >= 0)
+        return params.workers;
+    ZSTD_bounds bounds = ZSTD_cParam_getBounds(ZSTD_c_nbWorkers);
+    return std::clamp<int>(threads_per_job(), 1, bounds.upperBound);
+}
+
+Zstd::~Zstd()
+{
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeDDict(ddict);
+}
+
+void Zstd::configure(ZSTD_CCtx *cctx) const
+{
+    set_param(cctx, ZSTD_c_compressionLevel, params.level);
+    if (params.strategy)
+        set_param(cctx, ZSTD_c_strategy, params.strategy);
+    if (params.window_log)
+        set_param(cctx, ZSTD_c_windowLog, params.window_log);
+    if (params.hash_log)
+        set_param(cctx, ZSTD_c_hashLog, params.hash_log);
+    if (params.literal_mode)
+        set_param(cctx, ZSTD_c_literalCompressionMode, params.literal_mode);
+    // workers before the job parameters, which only exist in multithreaded mode
+    if (params.workers)
+        set_param(cctx, ZSTD_c_nbWorkers, worker_count());
+    if (params.job_size)
+        set_param(cctx, ZSTD_c_jobSize, params.job_size);
+    if (params.overlap_log)
+        set_param(cctx, ZSTD_c_overlapLog, params.overlap_log);
+    if (params.long_distance)
+        set_param(cctx, ZSTD_c_enableLongDistanceMatching, ZSTD_ps_enable);
+    if (cdict && ZSTD_isError(ZSTD_CCtx_refCDict(cctx, cdict)))
+        throw std::runtime_error("ZSTD dictionary rejected");
+}
+
+void Zstd::configure(ZSTD_DCtx *dctx) const
+{
+    // frames with windows above the default limit are refused unless the limit is raised
+    if (params.window_log > ZSTD_WINDOWLOG_LIMIT_DEFAULT)
+        ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, params.window_log);
+    if (ddict && ZSTD_isError(ZSTD_DCtx_refDDict(dctx, ddict)))
+        throw std::runtime_error("ZSTD dictionary rejected");
+}
+
+Zstd::context &Zstd::get_context()
+{
+    context &ctx = contexts.get();
+    if (!ctx.cctx)
+    {
+        ctx.cctx = ZSTD_createCCtx();
+        ctx.dctx = ZSTD_createDCtx();
+        if (!ctx.cctx || !ctx.dctx)
+            throw std::bad_alloc();
+        configure(ctx.cctx);
+        configure(ctx.dctx);
+    }
+    return ctx;
+}
 
 std::string Zstd::name()
 {
-    return "Zstd (" + std::to_string(level) + ")";
+    static const char *strategies[] = {"",     "fast",    "dfast", "greedy",  "lazy",
+                                       "lazy2", "btlazy2", "btopt", "btultra", "btultra2"};
+    // no commas, names go into csv files, and nothing generate_method_names.sh would leave in a Python identifier
+    std::string level = params.level < 0 ? "neg" + std::to_string(-params.level) : std::to_string(params.level);
+    std::string name = "Zstd (" + level;
+    if (params.strategy)
+        name += " " + std::string(strategies[params.strategy]);
+    if (params.window_log)
+        name += " wlog " + std::to_string(params.window_log);
+    if (params.hash_log)
+        name += " hlog " + std::to_string(params.hash_log);
+    if (params.literal_mode == ZSTD_ps_enable)
+        name += " huflit";
+    if (params.literal_mode == ZSTD_ps_disable)
+        name += " rawlit";
+    if (params.workers > 0)
+        name += " mt " + std::to_string(params.workers);
+    if (params.workers < 0)
+        name += " mt";
+    if (params.job_size)
+        name += " job " + std::to_string(params.job_size >> 10) + "KiB";
+    if (params.overlap_log)
+        name += " overlap " + std::to_string(params.overlap_log);
+    if (params.long_distance)
+        name += " ldm";
+    if (dictionary)
+        name += " dict " + std::to_string(dictionary->bytes().size() >> 10) + "KiB";
+    return name + ")";
 }
 
-std::span<const std::byte> Zstd::encode(std::span<const std::byte> input)
+size_t Zstd::max_encoded_size(size_t input_size)
+{
+    return ZSTD_compressBound(input_size) + sizeof(size_t);
+}
+
+size_t Zstd::encode_into(std::span<const std::byte> input, std::span<std::byte> output)
 {
     size_t input_sz = input.size_bytes();
-    compressed_buffer = std::vector<std::byte>(ZSTD_compressBound(input_sz) + sizeof(size_t));
-    size_t compressed_sz = ZSTD_compress(compressed_buffer.data() + sizeof(size_t),
-                                         compressed_buffer.size() - sizeof(size_t), input.data(), input_sz, level);
+    if (output.size() < sizeof(size_t))
+        return max_encoded_size(input_sz);
+    size_t compressed_sz = ZSTD_compress2(get_context().cctx, output.data() + sizeof(size_t),
+                                          output.size() - sizeof(size_t), input.data(), input_sz);
+    if (ZSTD_getErrorCode(compressed_sz) == ZSTD_error_dstSize_tooSmall)
+        return max_encoded_size(input_sz);
     if (ZSTD_isError(compressed_sz))
     {
         throw std::runtime_error("ZSTD compression failed");
     }
-    auto sz_span = std::as_bytes(std::span<size_t, 1>(&input_sz, 1));
-    std::copy(sz_span.begin(), sz_span.end(), compressed_buffer.begin());
-    compressed_buffer.resize(compressed_sz + sizeof(size_t));
-    return compressed_buffer;
+    std::memcpy(output.data(), &input_sz, sizeof(size_t));
+    return compressed_sz + sizeof(size_t);
 }
 
-std::span<const std::byte> Zstd::decode(std::span<const std::byte> input)
+size_t Zstd::decoded_size(std::span<const std::byte> input)
 {
-    size_t decompressed_sz = *reinterpret_cast<const size_t *>(input.data());
-    decompressed_buffer = std::vector<std::byte>(decompressed_sz);
-    size_t res = ZSTD_decompress(decompressed_buffer.data(), decompressed_sz, input.data() + sizeof(size_t),
-                                 input.size() - sizeof(size_t));
-    if (ZSTD_isError(res))
+    if (input.size() < sizeof(size_t))
+        throw std::runtime_error("Truncated ZSTD input");
+    size_t decompressed_sz;
+    std::memcpy(&decompressed_sz, input.data(), sizeof(size_t));
+    return decompressed_sz;
+}
+
+size_t Zstd::decode_into(std::span<const std::byte> input, std::span<std::byte> output)
+{
+    size_t decompressed_sz = decoded_size(input);
+    if (output.size() < decompressed_sz)
+        return decompressed_sz;
+    size_t res = ZSTD_decompressDCtx(get_context().dctx, output.data(), decompressed_sz,
+                                     input.data() + sizeof(size_t), input.size() - sizeof(size_t));
+    if (ZSTD_isError(res) || res != decompressed_sz)
     {
         throw std::runtime_error("ZSTD decompression failed");
     }
-    return decompressed_buffer;
+    return decompressed_sz;
+}
+
+// the same frame as encode_into, fed one segment at a time through the streaming API instead of from one buffer
+size_t Zstd::encode_segments_into(std::span<const std::span<const std::byte>> segments, std::span<std::byte> output)
+{
+    size_t input_sz = 0;
+    for (auto segment : segments)
+        input_sz += segment.size();
+    if (output.size() < sizeof(size_t))
+        return max_encoded_size(input_sz);
+    ZSTD_CCtx *cctx = get_context().cctx;
+    ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+    ZSTD_CCtx_setPledgedSrcSize(cctx, input_sz);
+    ZSTD_outBuffer out = {output.data() + sizeof(size_t), output.size() - sizeof(size_t), 0};
+    for (size_t i = 0; i <= segments.size(); i++)
+    {
+        // a final empty input ends the frame
+        bool last = i == segments.size();
+        ZSTD_inBuffer in = {last ? nullptr : segments[i].data(), last ? 0 : segments[i].size(), 0};
+        ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+        size_t remaining;
+        do
+        {
+            remaining = ZSTD_compressStream2(cctx, &out, &in, mode);
+            if (ZSTD_isError(remaining))
+            {
+                ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+                throw std::runtime_error("ZSTD compression failed");
+            }
+            if (out.pos == out.size && (in.pos < in.size || remaining != 0))
+            {
+                ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+                return max_encoded_size(input_sz);
+            }
+        } while (last ? remaining != 0 : in.pos < in.size);
+    }
+    std::memcpy(output.data(), &input_sz, sizeof(size_t));
+    return out.pos + sizeof(size_t);
 }
\ No newline at end of file
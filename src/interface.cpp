@@ -6,32 +6,36 @@
 #include <stdexcept>
 #include <string>
 
-template <typename F> bench_result_ex run_reconstruct(std::string method_str, void *data, int size, F error_bound)
+template <typename F>
+bench_result_ex run_reconstruct(std::string method_str, const void *input, void *output, size_t size, F error_bound)
 {
-    auto span = std::span<F>((F *)data, size);
-    for (std::shared_ptr<Method<F>> &method : get_all_methods<F>())
+    auto input_span = std::span<const F>((const F *)input, size);
+    auto output_span = std::span<F>((F *)output, size);
+    for (std::shared_ptr<Method<F>> &method : get_named_methods<F>())
     {
         if (method->name() == method_str)
         {
-            return benchmark<F>(span, *method, error_bound, span, true, true);
+            return benchmark<F>(input_span, *method, error_bound, output_span, true, true);
         }
     }
     throw std::runtime_error("Could not find method with name \"" + method_str + "\" for " +
                              std::to_string(sizeof(F)) + " byte float.");
 }
 
-extern "C" int reconstruct(bench_result *results, const char *method_name, char dtype, void *data, int size, double error_bound)
+// compresses input and decompresses it straight into output, which may be the same array
+extern "C" int reconstruct_into(bench_result *results, const char *method_name, char dtype, const void *input,
+                                void *output, size_t size, double error_bound)
 {
     try
     {
         std::string method_str(method_name);
         if (dtype == 'f')
         {
-            *results = run_reconstruct<float>(method_str, data, size, error_bound);
+            *results = run_reconstruct<float>(method_str, input, output, size, error_bound);
         }
         else if (dtype == 'd')
         {
-            *results = run_reconstruct<double>(method_str, data, size, error_bound);
+            *results = run_reconstruct<double>(method_str, input, output, size, error_bound);
         }
         else
         {
@@ -48,4 +52,10 @@ extern "C" int reconstruct(bench_result *results, const char *method_name, char
         std::cerr << "Unknown error." << std::endl;
     }
     return -1;
-}
\ No newline at end of file
+}
+
+// reconstructs data in place
+extern "C" int reconstruct(bench_result *results, const char *method_name, char dtype, void *data, int size, double error_bound)
+{
+    return reconstruct_into(results, method_name, dtype, data, data, size, error_bound);
+}
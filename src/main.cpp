@@ -1,11 +1,30 @@
 #include "benchmark.hpp"
+#include "buffer.hpp"
+#include "corpus.hpp"
+#include "encoding.hpp"
+#include "matrix.hpp"
+#include "method.hpp"
+#include "self_test.hpp"
+#include "small_blocks.hpp"
+#include "storage.hpp"
 #include "tabulate/font_align.hpp"
 #include "tabulate/table.hpp"
+#include "thread_pool.hpp"
 #include "util.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstddef>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <ostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <fenv.h>
@@ -19,6 +38,354 @@ template <typename F> class Method;
 
 extern "C" int reconstruct(bench_result *results, const char *method_name, char dtype, void *data, int size, double error_bound);
 
+static void format_table(Table &table)
+{
+    for (size_t col = 0; col < table.row(0).size(); col++)
+        table[0][col].format().font_align(FontAlign::center);
+    for (size_t col = 1; col < table.row(0).size(); col++)
+        for (size_t row = 1; row < table.size(); row++)
+            table[row][col].format().font_align(FontAlign::right);
+}
+
+static void print_results(std::vector<bench_result_ex> &results)
+{
+    Table table;
+    table.add_row({"Method", "Dataset", "Error Bound", "Ratio (%)", "Compression Time (ms)", "Rate (MB/s)",
+                   "Decompression Time (ms)", "Rate (MB/s)", "Max Error", "MAE"});
+    for (bench_result_ex r : results)
+    {
+        table.add_row({r.name, r.dataset, string_format("%g", r.error_bound),
+                       string_format("%.2f", (r.compressed_size * 100.f / r.original_size)),
+                       string_format("%f", r.compression_time * 1000.f), string_format("%f", r.compression_data_rate()),
+                       string_format("%f", r.decompression_time * 1000.f),
+                       string_format("%f", r.decompression_data_rate()), string_format("%f", r.max_error),
+                       string_format("%f", r.mean_absolute_error)});
+    }
+
+    format_table(table);
+
+    std::cout << table << std::endl;
+    table_to_file("results.csv", table);
+}
+
+// Estimates end-to-end transfer time over links of the given speeds (in Gb/s) from previously written results.
+static int link_report(std::string results_path, std::vector<double> bandwidths)
+{
+    std::vector<bench_result_ex> results = results_from_file(results_path);
+    if (results.empty())
+    {
+        std::cerr << "No results in " << results_path << std::endl;
+        return 1;
+    }
+
+    Table summary;
+    summary.add_row({"Bandwidth (Gb/s)", "Raw (ms)", "Best Sequential", "Time (ms)", "Speedup", "Best Pipelined",
+                     "Time (ms)", "Speedup"});
+    Table::Row_t header = {"Method"};
+    for (double gbps : bandwidths)
+    {
+        header.push_back(string_format("Sequential @ %g Gb/s (ms)", gbps));
+        header.push_back(string_format("Pipelined @ %g Gb/s (ms)", gbps));
+    }
+    Table full;
+    full.add_row(header);
+    std::vector<Table::Row_t> rows(results.size());
+    for (size_t i = 0; i < results.size(); i++)
+        rows[i].push_back(results[i].name);
+
+    for (double gbps : bandwidths)
+    {
+        double bandwidth = gbps * 1e9 / 8;
+        size_t best_seq = 0, best_pipe = 0;
+        double best_seq_speedup = 0, best_pipe_speedup = 0;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            link_cost c = estimate_link_cost(results[i], bandwidth);
+            // rank by speedup over sending the raw array so results for different inputs remain comparable
+            double raw_time = results[i].original_size / bandwidth;
+            if (raw_time / c.sequential_time > best_seq_speedup)
+            {
+                best_seq = i;
+                best_seq_speedup = raw_time / c.sequential_time;
+            }
+            if (raw_time / c.pipelined_time > best_pipe_speedup)
+            {
+                best_pipe = i;
+                best_pipe_speedup = raw_time / c.pipelined_time;
+            }
+            rows[i].push_back(string_format("%f", c.sequential_time * 1000.f));
+            rows[i].push_back(string_format("%f", c.pipelined_time * 1000.f));
+        }
+        link_cost seq = estimate_link_cost(results[best_seq], bandwidth);
+        link_cost pipe = estimate_link_cost(results[best_pipe], bandwidth);
+        double raw_time = results[best_seq].original_size / bandwidth;
+        summary.add_row({string_format("%g", gbps), string_format("%f", raw_time * 1000.f), results[best_seq].name, string_format("%f", seq.sequential_time * 1000.f),
+                         string_format("%.2fx", best_seq_speedup), results[best_pipe].name,
+                         string_format("%f", pipe.pipelined_time * 1000.f), string_format("%.2fx", best_pipe_speedup)});
+    }
+    for (auto &row : rows)
+        full.add_row(row);
+
+    format_table(summary);
+    std::cout << summary << std::endl;
+    table_to_file("link.csv", full);
+    return 0;
+}
+
+// Persists every method's output to a directory and reads it back, comparing against writing the raw array.
+template <typename F> static int storage_report(std::span<const F> data, storage_options options)
+{
+    std::vector<storage_result> results;
+    results.push_back(benchmark_storage_raw(data, options));
+    auto methods = get_all_methods<F>();
+    std::reverse(methods.begin(), methods.end());
+    while (!methods.empty())
+    {
+        std::cout << "Storing with " << methods.back()->name() << std::endl;
+        results.push_back(benchmark_storage<F>(data, *methods.back(), 1.0, options));
+        methods.pop_back();
+    }
+    if (options.drop_cache && !results[0].cache_dropped)
+        std::cerr << "Warning: could not drop the page cache, reads may be served from memory." << std::endl;
+
+    Table table;
+    table.add_row({"Method", "Ratio (%)", "Write Time (ms)", "Write Rate (MB/s)", "vs Raw", "Read Time (ms)",
+                   "Read Rate (MB/s)", "vs Raw"});
+    storage_result &raw = results[0];
+    for (storage_result &r : results)
+    {
+        table.add_row({r.name, string_format("%.2f", (r.compressed_size * 100.f / r.original_size)),
+                       string_format("%f", (r.compression_time + r.write_time) * 1000.f),
+                       string_format("%f", r.write_data_rate()),
+                       string_format("%.2fx", r.write_data_rate() / raw.write_data_rate()),
+                       string_format("%f", (r.read_time + r.decompression_time) * 1000.f),
+                       string_format("%f", r.read_data_rate()),
+                       string_format("%.2fx", r.read_data_rate() / raw.read_data_rate())});
+    }
+    format_table(table);
+    std::cout << table << std::endl;
+    table_to_file("storage.csv", table);
+    return 0;
+}
+
+// Compresses the second half of the data as independent small blocks with Zstd, with and without a dictionary trained
+// on blocks of the first half, so the dictionary is measured on blocks it was not trained on. An existing dictionary
+// file is used instead of training, a missing one is written after training.
+template <typename F>
+static int small_block_report(std::span<const F> values, size_t block_size, const std::string &dictionary_path)
+{
+    auto data = std::as_bytes(values);
+    size_t half = data.size() / 2 / block_size * block_size;
+    if (half == 0)
+    {
+        std::cerr << "The dataset needs at least two blocks of " << block_size << " bytes." << std::endl;
+        return 1;
+    }
+    std::shared_ptr<const ZstdDictionary> dictionary;
+    try
+    {
+        if (!dictionary_path.empty() && std::filesystem::exists(dictionary_path))
+        {
+            dictionary = std::make_shared<ZstdDictionary>(ZstdDictionary::load(dictionary_path));
+            std::cout << "Using dictionary " << dictionary_path << std::endl;
+        }
+        else
+        {
+            auto tstart = std::chrono::high_resolution_clock::now();
+            dictionary = std::make_shared<ZstdDictionary>(ZstdDictionary::train(data.first(half), block_size));
+            auto tend = std::chrono::high_resolution_clock::now();
+            std::cout << "Trained a " << dictionary->bytes().size() << " byte dictionary in "
+                      << std::chrono::duration<double>(tend - tstart).count() << " s" << std::endl;
+            if (!dictionary_path.empty())
+                dictionary->save(dictionary_path);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Cannot prepare the dictionary: " << e.what() << std::endl;
+        return 1;
+    }
+
+    Table table;
+    table.add_row({"Method", "Blocks", "Ratio (%)", "Compression Rate (MB/s)", "Decompression Rate (MB/s)",
+                   "Ratio Gain", "Compression Gain", "Decompression Gain"});
+    for (int level : {1, 3, 9})
+    {
+        Zstd plain(zstd_params{.level = level});
+        Zstd with_dictionary(zstd_params{.level = level}, dictionary);
+        small_block_result base = benchmark_small_blocks(data.subspan(half), block_size, plain);
+        small_block_result dict = benchmark_small_blocks(data.subspan(half), block_size, with_dictionary);
+        for (small_block_result *r : {&base, &dict})
+        {
+            table.add_row({r->name, std::to_string(r->block_count),
+                           string_format("%.2f", (r->compressed_size * 100.f / r->original_size)),
+                           string_format("%f", r->compression_data_rate()),
+                           string_format("%f", r->decompression_data_rate()),
+                           string_format("%.2fx", (double)base.compressed_size / r->compressed_size),
+                           string_format("%.2fx", r->compression_data_rate() / base.compression_data_rate()),
+                           string_format("%.2fx", r->decompression_data_rate() / base.decompression_data_rate())});
+        }
+    }
+    format_table(table);
+    std::cout << table << std::endl;
+    table_to_file("small_blocks.csv", table);
+    return 0;
+}
+
+static bool has_flag(int argc, char **argv, const std::string &flag)
+{
+    return std::find(argv, argv + argc, flag) != argv + argc;
+}
+
+template <typename F> std::vector<F> load_dataset(const corpus_file &file)
+{
+    if (file.path == "random")
+        return generate_random_data<F>(65536, -500, 500); // 20000000);
+    return read_corpus_file<F>(file);
+}
+
+// the default sweep, or the named methods including optional ones
+template <typename F> std::vector<std::string> method_names(const std::vector<std::string> &selected)
+{
+    std::vector<std::string> names;
+    for (auto &m : selected.empty() ? get_all_methods<F>() : get_named_methods<F>())
+        if (selected.empty() || std::find(selected.begin(), selected.end(), m->name()) != selected.end())
+            names.push_back(m->name());
+    return names;
+}
+
+// the selected names that are not a method for either type
+static std::vector<std::string> unknown_method_names(const std::vector<std::string> &selected)
+{
+    if (selected.empty())
+        return {};
+    std::vector<std::string> known = method_names<float>(selected), doubles = method_names<double>(selected);
+    known.insert(known.end(), doubles.begin(), doubles.end());
+    std::vector<std::string> unknown;
+    for (auto &name : selected)
+        if (std::find(known.begin(), known.end(), name) == known.end())
+            unknown.push_back(name);
+    return unknown;
+}
+
+template <typename F>
+static std::vector<bench_result_ex> run_dataset(const BenchmarkMatrix &matrix, const corpus_file &file,
+                                                const std::vector<matrix_entry> &entries, bool quiet)
+{
+    std::vector<bench_result_ex> results;
+    std::vector<F> data = load_dataset<F>(file);
+    data_profile profile = profile_data<F>(data, quiet ? 1 : 0);
+    std::vector<std::shared_ptr<Method<F>>> methods;
+    double error_bound = NAN;
+    for (const matrix_entry &e : entries)
+    {
+        // fresh methods for every error bound, each is released after it runs so the buffers in the encoders are
+        // freed as it goes which seems to give better performance.
+        if (methods.empty() || e.error_bound != error_bound)
+        {
+            methods = get_named_methods<F>();
+            error_bound = e.error_bound;
+        }
+        const std::string &name = matrix.dataset(e.dataset).methods[e.method];
+        auto method = std::find_if(methods.begin(), methods.end(), [&](auto &m) { return m && m->name() == name; });
+        if (method == methods.end())
+            throw std::runtime_error("method \"" + name + "\" is not available for " + file.path);
+        bench_result_ex r = benchmark<F>(data, **method, error_bound, std::span<F>(), quiet);
+        method->reset();
+        r.dataset = file.path;
+        r.error_bound = e.error_bound;
+        r.profile = profile;
+        r.matrix_id = matrix.id();
+        r.matrix_index = e.index;
+        r.matrix_size = matrix.size();
+        results.push_back(r);
+    }
+    return results;
+}
+
+// Runs shard k of n of the benchmark matrix, the whole matrix when n is 1. Files are loaded one at a time per job.
+static std::vector<bench_result_ex> run_matrix(const BenchmarkMatrix &matrix, const std::vector<corpus_file> &files,
+                                               size_t k, size_t n, size_t jobs)
+{
+    std::vector<std::vector<matrix_entry>> by_file(files.size());
+    for (const matrix_entry &e : matrix.shard(k, n))
+        by_file[e.dataset].push_back(e);
+    std::erase_if(by_file, [](auto &entries) { return entries.empty(); });
+
+    std::vector<bench_result_ex> results;
+    std::mutex results_mutex;
+    parallel_for(by_file.size(), jobs, [&](size_t i) {
+        const corpus_file &file = files[by_file[i].front().dataset];
+        bool quiet = jobs > 1;
+        auto file_results = file.dtype == 'd' ? run_dataset<double>(matrix, file, by_file[i], quiet)
+                                              : run_dataset<float>(matrix, file, by_file[i], quiet);
+        std::lock_guard<std::mutex> lock(results_mutex);
+        if (quiet)
+            std::cout << "Finished " << file.path << std::endl;
+        results.insert(results.end(), file_results.begin(), file_results.end());
+    });
+
+    std::sort(results.begin(), results.end(),
+              [](const bench_result_ex &a, const bench_result_ex &b) { return a.matrix_index < b.matrix_index; });
+    for (auto &r : results)
+        r.shard = string_format("%zu/%zu", k, n);
+    return results;
+}
+
+static void print_profiles(std::vector<bench_result_ex> &results)
+{
+    Table table;
+    table.add_row({"Dataset", "Values", "NaN", "Inf", "Min", "Max", "Lag-1 Autocorr.", "Mean |Diff|",
+                   "Mean |Diff2|", "Repeated (%)", "Distinct (est.)", "Byte Plane Entropy (bits)"});
+    std::vector<std::string> seen;
+    for (bench_result_ex &r : results)
+    {
+        if (std::find(seen.begin(), seen.end(), r.dataset) != seen.end())
+            continue;
+        seen.push_back(r.dataset);
+        data_profile &p = r.profile;
+        table.add_row({r.dataset, std::to_string(p.count), std::to_string(p.nan_count), std::to_string(p.inf_count),
+                       string_format("%g", p.min), string_format("%g", p.max),
+                       string_format("%.4f", p.lag1_autocorrelation), string_format("%g", p.mean_abs_diff1),
+                       string_format("%g", p.mean_abs_diff2), string_format("%.2f", p.repeated_fraction * 100),
+                       string_format("%.0f", p.cardinality), p.byte_entropy_string()});
+    }
+    format_table(table);
+    std::cout << table << std::endl;
+}
+
+static void print_aggregates(std::vector<bench_result_ex> &results, const std::vector<corpus_file> &files,
+                             const std::vector<double> &error_bounds)
+{
+    Table table;
+    table.add_row({"Method", "Error Bound", "Files", "Ratio (%)", "Geomean Ratio (%)", "Compression Rate (MB/s)",
+                   "Geomean (MB/s)", "Decompression Rate (MB/s)", "Geomean (MB/s)"});
+    for (corpus_aggregate &a : aggregate_corpus(results, files, error_bounds))
+    {
+        table.add_row({a.name, a.error_bound, std::to_string(a.files), string_format("%.2f", a.ratio_weighted() * 100),
+                       string_format("%.2f", a.ratio_geomean * 100), string_format("%f", a.compression_rate_weighted()),
+                       string_format("%f", a.compression_rate_geomean),
+                       string_format("%f", a.decompression_rate_weighted()),
+                       string_format("%f", a.decompression_rate_geomean)});
+    }
+    format_table(table);
+    std::cout << table << std::endl;
+    table_to_file("corpus.csv", table);
+}
+
+static void print_pool_stats()
+{
+    buffer_pool_stats s = buffer_pool::stats();
+    Table table;
+    table.add_row({"Allocations", "Reuses", "Huge Page Blocks", "THP Blocks", "In Use (MB)", "Peak In Use (MB)",
+                   "Cached (MB)"});
+    table.add_row({std::to_string(s.allocations), std::to_string(s.reuses), std::to_string(s.huge_blocks),
+                   std::to_string(s.thp_blocks), string_format("%.2f", s.bytes_in_use / 1e6),
+                   string_format("%.2f", s.peak_bytes_in_use / 1e6), string_format("%.2f", s.bytes_cached / 1e6)});
+    format_table(table);
+    std::cout << table << std::endl;
+}
+
 int main(int argc, char **argv)
 {
 #ifndef NDEBUG
@@ -29,6 +396,15 @@ int main(int argc, char **argv)
     // std::array<double, 1> x = {-364.52299570321952};
     // return reconstruct(&r, "Sz3", 'd', x.data(), x.size(), 1.0);
 
+    std::optional<storage_options> storage;
+    size_t small_block_size = 0;
+    std::string dictionary_path;
+    std::vector<corpus_file> files;
+    std::vector<std::string> selected_methods;
+    std::vector<double> error_bounds = {1.0};
+    size_t jobs = 1;
+    size_t shard = 1, shard_count = 1;
+    std::string out_path = "results_ex.csv";
     for (int i = 0; i < argc; i++)
     {
         if (std::string(argv[i]) == "--names")
@@ -37,45 +413,167 @@ int main(int argc, char **argv)
                 std::cout << s << std::endl;
             return 0;
         }
+        if (std::string(argv[i]) == "--self-test")
+            return self_test(std::cout) ? 1 : 0;
+        if (std::string(argv[i]) == "--link")
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "usage: " << argv[0] << " --link <results_ex.csv> [Gb/s,...]" << std::endl;
+                return 1;
+            }
+            std::vector<double> bandwidths = {1, 10, 25, 100};
+            if (i + 2 < argc)
+            {
+                bandwidths.clear();
+                for (auto &b : split_string(argv[i + 2], ','))
+                    bandwidths.push_back(std::stod(b));
+            }
+            return link_report(argv[i + 1], bandwidths);
+        }
+        if (std::string(argv[i]) == "--storage")
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "usage: " << argv[0] << " --storage <directory> [--direct] [--fsync] [--keep-cache]"
+                          << std::endl;
+                return 1;
+            }
+            storage = storage_options();
+            storage->directory = argv[i + 1];
+            storage->direct = has_flag(argc, argv, "--direct");
+            storage->fsync = has_flag(argc, argv, "--fsync");
+            storage->drop_cache = !has_flag(argc, argv, "--keep-cache");
+        }
+        if (std::string(argv[i]) == "--small-blocks")
+        {
+            if (i + 1 >= argc || std::stoull(argv[i + 1]) == 0)
+            {
+                std::cerr << "usage: " << argv[0] << " --small-blocks <KiB> [--dictionary <file>]" << std::endl;
+                return 1;
+            }
+            small_block_size = std::stoull(argv[++i]) << 10;
+        }
+        if (i + 1 < argc && std::string(argv[i]) == "--dictionary")
+            dictionary_path = argv[++i];
+        if (std::string(argv[i]) == "--merge")
+        {
+            if (i + 2 >= argc)
+            {
+                std::cerr << "usage: " << argv[0] << " --merge <merged.csv> <shard.csv>..." << std::endl;
+                return 1;
+            }
+            try
+            {
+                std::vector<std::vector<bench_result_ex>> shards;
+                for (int j = i + 2; j < argc; j++)
+                    shards.push_back(results_from_file(argv[j]));
+                auto merged = merge_shards(shards);
+                print_results(merged);
+                results_to_file(argv[i + 1], merged);
+                return 0;
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Cannot merge: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        if (i + 1 < argc && std::string(argv[i]) == "--data")
+            files.push_back(describe_file(argv[++i]));
+        if (i + 1 < argc && std::string(argv[i]) == "--corpus")
+        {
+            auto corpus = load_corpus(argv[++i]);
+            files.insert(files.end(), corpus.begin(), corpus.end());
+        }
+        if (i + 1 < argc && std::string(argv[i]) == "--method")
+            selected_methods.push_back(argv[++i]);
+        if (i + 1 < argc && std::string(argv[i]) == "--jobs")
+            jobs = std::stoull(argv[++i]);
+        if (i + 1 < argc && std::string(argv[i]) == "--error-bounds")
+        {
+            error_bounds.clear();
+            for (auto &e : split_string(argv[++i], ','))
+                error_bounds.push_back(std::stod(e));
+        }
+        if (i + 1 < argc && std::string(argv[i]) == "--shard")
+        {
+            if (std::sscanf(argv[++i], "%zu/%zu", &shard, &shard_count) != 2 || shard == 0 || shard > shard_count)
+            {
+                std::cerr << "--shard expects k/n with 1 <= k <= n" << std::endl;
+                return 1;
+            }
+        }
+        if (i + 1 < argc && std::string(argv[i]) == "--out")
+            out_path = argv[++i];
+    }
+    if (files.empty())
+    {
+        corpus_file random;
+        random.path = "random";
+        random.dtype = sizeof(real) == sizeof(double) ? 'd' : 'f';
+        files.push_back(random);
     }
 
-    std::vector<real> original_buffer = generate_random_data<real>(65536, -500, 500); // 20000000);
+    if (storage)
+    {
+        if (files.front().dtype == 'd')
+            return storage_report<double>(load_dataset<double>(files.front()), *storage);
+        return storage_report<float>(load_dataset<float>(files.front()), *storage);
+    }
+    if (small_block_size)
+    {
+        if (files.front().dtype == 'd')
+            return small_block_report<double>(load_dataset<double>(files.front()), small_block_size, dictionary_path);
+        return small_block_report<float>(load_dataset<float>(files.front()), small_block_size, dictionary_path);
+    }
     //  vec_to_file("data.vec", original_buffer);
     // std::vector<real> original_buffer = vec_from_file<float>("/home/bem@PADNT/spdp/bin/msg_sppm.sp.spdp.bin");
     // bench_result res;
     // reconstruct(&res, "LfZip with Stream Split (V) with Lz4", 'd', void *data, original_buffer.size(), 1e-6);
     // return 0;
 
-    std::vector<bench_result_ex> results;
-    auto methods = get_all_methods<real>();
-    // reversing and popping back ensures the buffers in the encoders are freed as it goes which seems to give better
-    // performance.
-    std::reverse(methods.begin(), methods.end());
-    while(!methods.empty())
+    set_concurrent_jobs(jobs);
+    auto unknown = unknown_method_names(selected_methods);
+    for (auto &name : unknown)
+        std::cerr << "Unknown method \"" << name << "\", --names lists them" << std::endl;
+    if (!unknown.empty())
+        return 1;
+    std::vector<matrix_dataset> matrix_datasets;
+    for (auto &f : files)
     {
-        results.emplace_back(benchmark<real>(original_buffer, *methods.back(), 1.0));
-        methods.pop_back();
-    }
-
-    Table table;
-    table.add_row({"Method", "Ratio (%)", "Compression Time (ms)", "Rate (MB/s)", "Decompression Time (ms)",
-                   "Rate (MB/s)", "Max Error", "MAE"});
-    for (bench_result_ex r : results)
-    {
-        table.add_row({r.name, string_format("%.2f", (r.compressed_size * 100.f / r.original_size)),
-                       string_format("%f", r.compression_time * 1000.f), string_format("%f", r.compression_data_rate()),
-                       string_format("%f", r.decompression_time * 1000.f),
-                       string_format("%f", r.decompression_data_rate()), string_format("%f", r.max_error),
-                       string_format("%f", r.mean_absolute_error)});
+        auto names = f.dtype == 'd' ? method_names<double>(selected_methods) : method_names<float>(selected_methods);
+        if (names.empty())
+        {
+            std::cerr << "No selected method is available for " << f.path << std::endl;
+            return 1;
+        }
+        // rejected now rather than after the whole run, when the results are written
+        for (auto &field : names)
+        {
+            if (!csv_field_ok(field))
+            {
+                std::cerr << "Method name \"" << field << "\" cannot be written to csv" << std::endl;
+                return 1;
+            }
+        }
+        if (!csv_field_ok(f.path))
+        {
+            std::cerr << "Dataset path \"" << f.path << "\" has a comma or line break, which csv results cannot hold"
+                      << std::endl;
+            return 1;
+        }
+        matrix_datasets.push_back({f.path, f.error_bounds.empty() ? error_bounds : f.error_bounds, names});
     }
+    BenchmarkMatrix matrix(matrix_datasets);
 
-    for (size_t col = 0; col < table.row(0).size(); col++)
-        table[0][col].format().font_align(FontAlign::center);
-    for (size_t col = 1; col < table.row(0).size(); col++)
-        for (size_t row = 1; row < table.size(); row++)
-            table[row][col].format().font_align(FontAlign::right);
-
-    std::cout << table << std::endl;
-    table_to_file("results.csv", table);
+    std::vector<bench_result_ex> results = run_matrix(matrix, files, shard, shard_count, jobs);
+    print_results(results);
+    print_profiles(results);
+    if (files.size() > 1)
+        print_aggregates(results, files, error_bounds);
+    if (has_flag(argc, argv, "--pool-stats"))
+        print_pool_stats();
+    results_to_file(out_path, results);
     return 0;
 }
\ No newline at end of file
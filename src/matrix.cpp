@@ -0,0 +1,91 @@
+#include "matrix.hpp"
+#include "benchmark.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+static uint64_t fnv1a(const std::string &str, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    for (char c : str)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+BenchmarkMatrix::BenchmarkMatrix(std::vector<matrix_dataset> datasets) : datasets(std::move(datasets))
+{
+    uint64_t hash = fnv1a("");
+    for (size_t d = 0; d < this->datasets.size(); d++)
+    {
+        auto &dataset = this->datasets[d];
+        for (double error_bound : dataset.error_bounds)
+        {
+            for (size_t m = 0; m < dataset.methods.size(); m++)
+            {
+                entries.push_back({entries.size(), d, error_bound, m});
+                hash = fnv1a(string_format("%s\n%.17g\n%s\n", dataset.name.c_str(), error_bound,
+                                           dataset.methods[m].c_str()),
+                             hash);
+            }
+        }
+    }
+    matrix_id = string_format("%016llx", (unsigned long long)hash);
+}
+
+std::vector<matrix_entry> BenchmarkMatrix::shard(size_t k, size_t n) const
+{
+    if (n == 0 || k == 0 || k > n)
+        throw std::runtime_error(string_format("invalid shard %zu/%zu", k, n));
+    std::vector<matrix_entry> result;
+    for (size_t i = k - 1; i < entries.size(); i += n)
+        result.push_back(entries[i]);
+    return result;
+}
+
+std::vector<bench_result_ex> merge_shards(std::vector<std::vector<bench_result_ex>> shards)
+{
+    std::vector<bench_result_ex> merged;
+    for (auto &shard : shards)
+        merged.insert(merged.end(), shard.begin(), shard.end());
+    if (merged.empty())
+        throw std::runtime_error("no results to merge");
+
+    const bench_result_ex &first = merged.front();
+    size_t shard = 0, shard_count = 0;
+    if (std::sscanf(first.shard.c_str(), "%zu/%zu", &shard, &shard_count) != 2 || shard_count == 0)
+        throw std::runtime_error("results are not from a sharded run");
+    std::vector<std::string> seen_shards;
+    for (auto &shard : shards)
+    {
+        for (auto &r : shard)
+        {
+            if (r.matrix_id != first.matrix_id || r.matrix_size != first.matrix_size)
+                throw std::runtime_error("results come from different benchmark matrices (" + first.matrix_id +
+                                         " and " + r.matrix_id + ")");
+        }
+        if (!shard.empty())
+            seen_shards.push_back(shard.front().shard);
+    }
+    std::sort(seen_shards.begin(), seen_shards.end());
+    if (std::adjacent_find(seen_shards.begin(), seen_shards.end()) != seen_shards.end())
+        throw std::runtime_error("the same shard was given more than once");
+
+    std::sort(merged.begin(), merged.end(),
+              [](const bench_result_ex &a, const bench_result_ex &b) { return a.matrix_index < b.matrix_index; });
+    for (size_t i = 0; i < merged.size(); i++)
+    {
+        if (merged[i].matrix_index < i)
+            throw std::runtime_error(string_format("matrix entry %zu appears more than once", merged[i].matrix_index));
+        if (merged[i].matrix_index > i)
+            throw std::runtime_error(string_format("matrix entry %zu is missing (%zu shards of %zu given)", i,
+                                                   shards.size(), shard_count));
+    }
+    if (merged.size() != first.matrix_size)
+        throw std::runtime_error(string_format("matrix entries %zu to %zu are missing (%zu shards of %zu given)",
+                                               merged.size(), first.matrix_size - 1, shards.size(), shard_count));
+    return merged;
+}
@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <span>
+#include <stdexcept>
 
 // template <typename  F> constexpr F get_greatest_precise_int();
 // template <> constexpr double get_greatest_precise_int()
@@ -146,9 +147,9 @@ template <typename F> void from_uint(const F *input, size_t sz, F *out, F e)
 
 template <typename F> size_t IntFloat<F>::compress(std::span<const F> input)
 {
-    std::unique_ptr<F[]> out(new F[input.size()]);
+    pooled_array<F> out(input.size());
     to_uint(input.data(), input.size(), out.get(), Method<F>::error);
-    compressed_span = encoding->encode(std::as_bytes(std::span(out.get(), input.size())));
+    compressed_span = encoding->encode(std::as_bytes(out.span()));
     return compressed_span.size_bytes();
 }
 
@@ -157,9 +158,21 @@ template <typename F> std::span<const F> IntFloat<F>::decompress()
     std::span<const std::byte> decoded = encoding->decode(compressed_span);
     const F *input = reinterpret_cast<const F *>(decoded.data());
     const size_t outputSz = decoded.size_bytes() / sizeof(F);
-    results.reset(new F[outputSz]);
+    if (results.size() != outputSz)
+        results = pooled_array<F>(outputSz);
     from_uint(input, outputSz, results.get(), Method<F>::error);
     return std::span<const F>(results.get(), outputSz);
 }
+
+template <typename F> size_t IntFloat<F>::decompress_into(std::span<F> output)
+{
+    // decode the integers into the caller's buffer and convert them back in place
+    size_t decoded_sz = encoding->decode_into(compressed_span, std::as_writable_bytes(output));
+    if (decoded_sz > output.size_bytes())
+        throw std::runtime_error("Output buffer too small for " + name());
+    const size_t outputSz = decoded_sz / sizeof(F);
+    from_uint(output.data(), outputSz, output.data(), Method<F>::error);
+    return outputSz;
+}
 template class IntFloat<float>;
 template class IntFloat<double>;
@@ -2,6 +2,7 @@
 #include "encoding.hpp"
 #include "method.hpp"
 #include "util.hpp"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
@@ -9,6 +10,7 @@
 #include <eigen3/Eigen/Core>
 #include <limits>
 #include <span>
+#include <stdexcept>
 #include <vector>
 
 template <typename F, size_t N, int stride> class NlmsFilter
@@ -80,113 +82,148 @@ size_t Lfzip<F, split, stride, encode>::compress(std::span<const F> input)
 {
     // std::vector<int16_t> test = vec_from_file<int16_t>("../../LFZip/debug/bin_idx.0");
 
+    constexpr size_t window = (filter_size + 1) * stride;
+    arena.reset();
     NlmsFilter<F, filter_size, stride> nlms;
-    std::vector<int16_t> indices;
-    std::vector<F> outliers;
-    std::vector<F> recon;
-    recon.reserve(input.size());
-    indices.reserve(input.size());
+    std::span<int16_t> indices = arena.allocate<int16_t>(input.size());
+    std::span<F> outliers = arena.allocate<F>(input.size());
+    std::span<F> recon = arena.allocate<F>(input.size());
+    size_t outlier_count = 0;
 
-    for (const F v : input)
+    for (size_t i = 0; i < input.size(); i++)
     {
-        auto sample_start = std::max(recon.end() - (filter_size + 1) * stride, recon.begin());
-        F predval = nlms.predict(std::span<const F>(sample_start, recon.end()));
+        const F v = input[i];
+        size_t history = std::min(i, window);
+        F predval = nlms.predict(recon.subspan(i - history, history));
         F diff = v - predval;
         int16_t index = std::round(diff / (2 * Method<F>::error));
         F reconstruction = predval + Method<F>::error * index * 2;
         if (index != std::numeric_limits<int16_t>::min() && std::abs(v - reconstruction) <= Method<F>::error)
         {
             if constexpr (encode)
-                indices.push_back(encode_index(index));
+                indices[i] = encode_index(index);
             else
-                indices.push_back(index);
-            recon.push_back(reconstruction);
+                indices[i] = index;
+            recon[i] = reconstruction;
         }
         else
         {
             if constexpr (encode)
             {
                 constexpr int16_t encoded_min = encode_index(std::numeric_limits<int16_t>::min());
-                indices.push_back(encoded_min);
+                indices[i] = encoded_min;
             }
             else
             {
-                indices.push_back(std::numeric_limits<int16_t>::min());
+                indices[i] = std::numeric_limits<int16_t>::min();
             }
-            outliers.push_back(v);
-            recon.push_back(v);
+            outliers[outlier_count++] = v;
+            recon[i] = v;
         }
     }
 
     // assert(indices == test);
 
-    std::vector<std::byte> stream;
+    // std::cout << "Lfzip before compression: " << stream.size() << std::endl;
+    compressed_span = encoding->encode_segments(pack(outliers.first(outlier_count), indices).segments());
+    // std::cout << "Lfzip after compression: " << compressed_buffer.size() << std::endl;
+    return compressed_span.size_bytes();
+}
+
+template <typename F, bool split, int stride, bool encode>
+PackedStreams<2> Lfzip<F, split, stride, encode>::pack(std::span<const F> outliers, std::span<const int16_t> indices)
+{
     if constexpr (split)
     {
-        auto outlier_ss = streamsplit_enc<F>(std::as_bytes(std::span(outliers)));
-        auto indicies_ss = streamsplit_enc<uint16_t>(std::as_bytes(std::span(indices)));
-        stream = pack_streams(std::span(outlier_ss), std::span(indicies_ss));
+        auto outlier_ss = arena.allocate<std::byte>(outliers.size_bytes());
+        auto indicies_ss = arena.allocate<std::byte>(indices.size_bytes());
+        streamsplit_enc_into<F>(std::as_bytes(outliers), outlier_ss);
+        streamsplit_enc_into<uint16_t>(std::as_bytes(indices), indicies_ss);
+        return PackedStreams(outlier_ss, indicies_ss);
     }
     else
     {
-        stream = pack_streams(std::span(outliers), std::span(indices));
+        return PackedStreams(outliers, indices);
     }
-    // std::cout << "Lfzip before compression: " << stream.size() << std::endl;
-    compressed_span = encoding->encode(stream);
-    // std::cout << "Lfzip after compression: " << compressed_buffer.size() << std::endl;
-    return compressed_span.size_bytes();
 }
 
 template <typename F, bool split, int stride, bool encode>
-std::span<const F> Lfzip<F, split, stride, encode>::decompress()
+void Lfzip<F, split, stride, encode>::decode_streams(std::span<const F> &outliers, std::span<const std::byte> &indices)
 {
-    // std::vector<F> test = vec_from_file<F>("../../LFZip/debug/recon.bin");
-
+    arena.reset();
     std::span<const std::byte> decompressed_buffer = encoding->decode(compressed_span);
-    std::span<const F> outliers;
-    std::span<const int16_t> indices;
-
-    std::vector<std::byte> outliers_vec;
-    std::vector<std::byte> indices_vec;
     if constexpr (split)
     {
         std::span<const std::byte> outliers_tmp;
-        std::span<const std::byte> indices_tmp;
-        unpack_streams(decompressed_buffer, outliers_tmp, indices_tmp);
-        outliers_vec = streamsplit_dec<F>(outliers_tmp);
-        indices_vec = streamsplit_dec<uint16_t>(indices_tmp);
-        outliers = as_typed_span<F>(outliers_vec);
-        indices = as_typed_span<int16_t>(indices_vec);
+        unpack_streams(decompressed_buffer, arena, outliers_tmp, indices);
+        auto outliers_buffer = arena.allocate<std::byte>(outliers_tmp.size_bytes());
+        streamsplit_dec_into<F>(outliers_tmp, outliers_buffer);
+        outliers = as_typed_span<F>(outliers_buffer);
     }
     else
     {
-        unpack_streams(decompressed_buffer, outliers, indices);
+        std::span<const int16_t> indices_tmp;
+        unpack_streams(decompressed_buffer, arena, outliers, indices_tmp);
+        indices = std::as_bytes(indices_tmp);
     }
+}
 
-    result.clear();
-    result.reserve(indices.size());
+template <typename F, bool split, int stride, bool encode>
+void Lfzip<F, split, stride, encode>::reconstruct(std::span<const F> outliers, std::span<const std::byte> indices,
+                                                  std::span<F> output)
+{
+    // std::vector<F> test = vec_from_file<F>("../../LFZip/debug/recon.bin");
+
+    assert(output.size() >= indices.size() / sizeof(int16_t));
+    constexpr size_t window = (filter_size + 1) * stride;
     NlmsFilter<F, filter_size, stride> nlms;
     auto outlier = outliers.begin();
-    for (int16_t v : indices)
-    {
-        auto sample_start = std::max(result.end() - (filter_size + 1) * stride, result.begin());
-        F predval = nlms.predict(std::span<const F>(sample_start, result.end()));
-        if constexpr (encode)
-            v = decode_index(v);
-        if (v == std::numeric_limits<int16_t>::min())
+    for_each_index_tile<split>(indices, [&](size_t first, std::span<const int16_t> tile) {
+        for (size_t t = 0; t < tile.size(); t++)
         {
-            assert(outlier != outliers.end());
-            result.push_back(*(outlier++));
-        }
-        else
-        {
-                result.push_back(predval + Method<F>::error * v * 2);
+            size_t i = first + t;
+            size_t history = std::min(i, window);
+            F predval = nlms.predict(output.subspan(i - history, history));
+            int16_t v = tile[t];
+            if constexpr (encode)
+                v = decode_index(v);
+            if (v == std::numeric_limits<int16_t>::min())
+            {
+                assert(outlier != outliers.end());
+                output[i] = *(outlier++);
+            }
+            else
+            {
+                output[i] = predval + Method<F>::error * v * 2;
+            }
         }
-    }
-    // std::cout << "magic sum: " << std::accumulate(result.begin(), result.end(), 0.0L) << std::endl;
+    });
     // assert(result == test);
+}
+
+template <typename F, bool split, int stride, bool encode>
+std::span<const F> Lfzip<F, split, stride, encode>::decompress()
+{
+    std::span<const F> outliers;
+    std::span<const std::byte> indices;
+    decode_streams(outliers, indices);
+    result.resize(indices.size() / sizeof(int16_t));
+    reconstruct(outliers, indices, result);
     return result;
 }
+
+template <typename F, bool split, int stride, bool encode>
+size_t Lfzip<F, split, stride, encode>::decompress_into(std::span<F> output)
+{
+    std::span<const F> outliers;
+    std::span<const std::byte> indices;
+    decode_streams(outliers, indices);
+    size_t count = indices.size() / sizeof(int16_t);
+    if (output.size() < count)
+        throw std::runtime_error("Output buffer too small for " + name());
+    reconstruct(outliers, indices, output);
+    return count;
+}
 template class Lfzip<float, true, 1>;
 template class Lfzip<float, false, 1>;
 template class Lfzip<double, true, 1>;
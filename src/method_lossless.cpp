@@ -1,6 +1,7 @@
 #include "method.hpp"
 #include "util.hpp"
 #include <span>
+#include <stdexcept>
 
 template <typename F> size_t Lossless<F>::compress(std::span<const F> input)
 {
@@ -12,5 +13,13 @@ template <typename F> std::span<const F> Lossless<F>::decompress()
 {
     return as_typed_span<F>(encoding->decode(compressed_span));
 }
+
+template <typename F> size_t Lossless<F>::decompress_into(std::span<F> output)
+{
+    size_t decoded_sz = encoding->decode_into(compressed_span, std::as_writable_bytes(output));
+    if (decoded_sz > output.size_bytes())
+        throw std::runtime_error("Output buffer too small for " + name());
+    return decoded_sz / sizeof(F);
+}
 template class Lossless<float>;
 template class Lossless<double>;
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "method.hpp"
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <machete.h>
 #include <stdexcept>
 
@@ -18,7 +20,24 @@ size_t Machete::compress(std::span<const double> input)
 
 std::span<const double> Machete::decompress()
 {
-    results = std::vector<double>(in_sz);
+    results.resize(in_sz);
     machete_decompress<lorenzo1, hybrid>(compressed_buffer, out_sz, results.data());
     return results;
-}
\ No newline at end of file
+}
+
+size_t Machete::decompress_into(std::span<double> output)
+{
+    if (output.size() < in_sz)
+        throw std::runtime_error("Output buffer too small for " + name());
+    machete_decompress<lorenzo1, hybrid>(compressed_buffer, out_sz, output.data());
+    return in_sz;
+}
+
+void Machete::load(std::span<const std::byte> data)
+{
+    if (compressed_buffer)
+        std::free(compressed_buffer);
+    compressed_buffer = static_cast<uint8_t *>(std::malloc(data.size_bytes()));
+    std::memcpy(compressed_buffer, data.data(), data.size_bytes());
+    out_sz = data.size_bytes();
+}
@@ -5,6 +5,7 @@
 #include <ieee754.h>
 #include <immintrin.h>
 #include <memory>
+#include <stdexcept>
 
 void mask(const float *input, size_t sz, float *out, float e)
 {
@@ -97,9 +98,9 @@ void mask(const double *input, size_t sz, double *out, double e)
 
 template <typename F> size_t Mask<F>::compress(std::span<const F> input)
 {
-    std::unique_ptr<F[]> out(new F[input.size()]);
-    mask(&input[0], input.size(), &out[0], Method<F>::error);
-    compressed_span = encoding->encode(std::as_bytes(std::span(out.get(), input.size())));
+    pooled_array<F> out(input.size());
+    mask(input.data(), input.size(), out.get(), Method<F>::error);
+    compressed_span = encoding->encode(std::as_bytes(out.span()));
     return compressed_span.size_bytes();
 }
 
@@ -107,5 +108,13 @@ template <typename F> std::span<const F> Mask<F>::decompress()
 {
     return as_typed_span<F>(encoding->decode(compressed_span));
 }
+
+template <typename F> size_t Mask<F>::decompress_into(std::span<F> output)
+{
+    size_t decoded_sz = encoding->decode_into(compressed_span, std::as_writable_bytes(output));
+    if (decoded_sz > output.size_bytes())
+        throw std::runtime_error("Output buffer too small for " + name());
+    return decoded_sz / sizeof(F);
+}
 template class Mask<float>;
 template class Mask<double>;
@@ -3,6 +3,7 @@
 #include "util.hpp"
 #include <cmath>
 #include <limits>
+#include <stdexcept>
 #include <vector>
 
 static constexpr inline int16_t encode_index(int16_t i)
@@ -36,21 +37,23 @@ static constexpr inline int16_t decode_index(int16_t i)
 
 template <typename F, bool split, bool encode> size_t Quantise<F, split, encode>::compress(std::span<const F> input)
 {
-    std::vector<F> outliers;
-    std::vector<int16_t> indices;
-    indices.reserve(input.size());
+    arena.reset();
+    std::span<F> outliers = arena.allocate<F>(input.size());
+    std::span<int16_t> indices = arena.allocate<int16_t>(input.size());
+    size_t outlier_count = 0;
     F prev = 0;
-    for (const F v : input)
+    for (size_t i = 0; i < input.size(); i++)
     {
+        const F v = input[i];
         F diff = v - prev;
         int16_t index = std::round(diff / (2 * Method<F>::error));
         F reconstruction = prev + Method<F>::error * index * 2;
         if (index != std::numeric_limits<int16_t>::min() && std::abs(v - reconstruction) <= Method<F>::error)
         {
             if constexpr (encode)
-                indices.push_back(encode_index(index));
+                indices[i] = encode_index(index);
             else
-                indices.push_back(index);
+                indices[i] = index;
             prev = reconstruction;
         }
         else
@@ -58,77 +61,113 @@ template <typename F, bool split, bool encode> size_t Quantise<F, split, encode>
             if constexpr (encode)
             {
                 constexpr int16_t encoded_min = encode_index(std::numeric_limits<int16_t>::min());
-                indices.push_back(encoded_min);
+                indices[i] = encoded_min;
             }
             else
             {
-                indices.push_back(std::numeric_limits<int16_t>::min());
+                indices[i] = std::numeric_limits<int16_t>::min();
             }
-            outliers.push_back(v);
+            outliers[outlier_count++] = v;
             prev = v;
         }
     }
 
-    std::vector<std::byte> stream;
+    compressed_span = encoding->encode_segments(pack(outliers.first(outlier_count), indices).segments());
+    return compressed_span.size_bytes();
+}
+
+template <typename F, bool split, bool encode>
+PackedStreams<2> Quantise<F, split, encode>::pack(std::span<const F> outliers, std::span<const int16_t> indices)
+{
     if constexpr (split)
     {
-        auto outlier_ss = streamsplit_enc<F>(std::as_bytes(std::span(outliers)));
-        auto indicies_ss = streamsplit_enc<uint16_t>(std::as_bytes(std::span(indices)));
-        stream = pack_streams(std::span(outlier_ss), std::span(indicies_ss));
+        auto outlier_ss = arena.allocate<std::byte>(outliers.size_bytes());
+        auto indicies_ss = arena.allocate<std::byte>(indices.size_bytes());
+        streamsplit_enc_into<F>(std::as_bytes(outliers), outlier_ss);
+        streamsplit_enc_into<uint16_t>(std::as_bytes(indices), indicies_ss);
+        return PackedStreams(outlier_ss, indicies_ss);
     }
     else
     {
-        stream = pack_streams(std::span(outliers), std::span(indices));
+        return PackedStreams(outliers, indices);
     }
-    compressed_span = encoding->encode(stream);
-    return compressed_span.size_bytes();
 }
 
-template <typename F, bool split, bool encode> std::span<const F> Quantise<F, split, encode>::decompress()
+template <typename F, bool split, bool encode>
+void Quantise<F, split, encode>::decode_streams(std::span<const F> &outliers, std::span<const std::byte> &indices)
 {
+    arena.reset();
     std::span<const std::byte> decompressed_buffer = encoding->decode(compressed_span);
-    std::span<const F> outliers;
-    std::span<const int16_t> indices;
-
-    std::vector<std::byte> outliers_vec;
-    std::vector<std::byte> indices_vec;
     if constexpr (split)
     {
         std::span<const std::byte> outliers_tmp;
-        std::span<const std::byte> indices_tmp;
-        unpack_streams(decompressed_buffer, outliers_tmp, indices_tmp);
-        outliers_vec = streamsplit_dec<F>(outliers_tmp);
-        indices_vec = streamsplit_dec<uint16_t>(indices_tmp);
-        outliers = as_typed_span<F>(outliers_vec);
-        indices = as_typed_span<int16_t>(indices_vec);
+        unpack_streams(decompressed_buffer, arena, outliers_tmp, indices);
+        auto outliers_buffer = arena.allocate<std::byte>(outliers_tmp.size_bytes());
+        streamsplit_dec_into<F>(outliers_tmp, outliers_buffer);
+        outliers = as_typed_span<F>(outliers_buffer);
     }
     else
     {
-        unpack_streams(decompressed_buffer, outliers, indices);
+        std::span<const int16_t> indices_tmp;
+        unpack_streams(decompressed_buffer, arena, outliers, indices_tmp);
+        indices = std::as_bytes(indices_tmp);
     }
+}
 
-    result.clear();
-    result.reserve(indices.size());
-
+template <typename F, bool split, bool encode>
+void Quantise<F, split, encode>::reconstruct(std::span<const F> outliers, std::span<const std::byte> indices,
+                                             std::span<F> output)
+{
+    assert(output.size() >= indices.size() / sizeof(int16_t));
     auto outlier = outliers.begin();
     F value = 0;
-    for (int16_t v : indices)
-    {
-        if constexpr (encode)
-            v = decode_index(v);
-        if (v == std::numeric_limits<int16_t>::min())
+    const F error = Method<F>::error;
+    for_each_index_tile<split>(indices, [&](size_t first, std::span<const int16_t> tile) {
+        // locals, so the stores to output cannot alias the running state
+        auto next_outlier = outlier;
+        F current = value;
+        F *out = output.data() + first;
+        for (int16_t v : tile)
         {
-            assert(outlier != outliers.end());
-            value = *(outlier++);
-        }
-        else
-        {
-            value = value + Method<F>::error * v * 2;
+            if constexpr (encode)
+                v = decode_index(v);
+            if (v == std::numeric_limits<int16_t>::min())
+            {
+                assert(next_outlier != outliers.end());
+                current = *(next_outlier++);
+            }
+            else
+            {
+                current = current + error * v * 2;
+            }
+            *(out++) = current;
         }
-        result.push_back(value);
-    }
+        outlier = next_outlier;
+        value = current;
+    });
+}
+
+template <typename F, bool split, bool encode> std::span<const F> Quantise<F, split, encode>::decompress()
+{
+    std::span<const F> outliers;
+    std::span<const std::byte> indices;
+    decode_streams(outliers, indices);
+    result.resize(indices.size() / sizeof(int16_t));
+    reconstruct(outliers, indices, result);
     return result;
 }
+
+template <typename F, bool split, bool encode> size_t Quantise<F, split, encode>::decompress_into(std::span<F> output)
+{
+    std::span<const F> outliers;
+    std::span<const std::byte> indices;
+    decode_streams(outliers, indices);
+    size_t count = indices.size() / sizeof(int16_t);
+    if (output.size() < count)
+        throw std::runtime_error("Output buffer too small for " + name());
+    reconstruct(outliers, indices, output);
+    return count;
+}
 template class Quantise<float, true>;
 template class Quantise<float, false>;
 template class Quantise<double, true>;
@@ -1,5 +1,7 @@
 #include "SZ3/api/sz.hpp"
 #include "method.hpp"
+#include <cstring>
+#include <stdexcept>
 
 template <typename F> size_t Sz3<F>::compress(std::span<const F> input)
 {
@@ -8,6 +10,7 @@ template <typename F> size_t Sz3<F>::compress(std::span<const F> input)
     conf.errorBoundMode = SZ3::EB_ABS;
     conf.absErrorBound = Method<F>::error;
     compressed_data.reset(SZ_compress<F>(conf, input.data(), compressed_size));
+    input_size = input.size();
     return compressed_size;
 }
 
@@ -18,5 +21,22 @@ template <typename F> std::span<const F> Sz3<F>::decompress()
     decompressed_size = conf.num;
     return std::span(decompressed_data.get(), conf.num);
 }
+template <typename F> size_t Sz3<F>::decompress_into(std::span<F> output)
+{
+    // SZ3 writes straight into a non-null pointer, so the size has to be checked beforehand
+    if (output.size() < input_size)
+        throw std::runtime_error("Output buffer too small for " + name());
+    SZ3::Config conf;
+    F *output_ptr = output.data();
+    SZ_decompress<F>(conf, compressed_data.get(), compressed_size, output_ptr);
+    return conf.num;
+}
+
+template <typename F> void Sz3<F>::load(std::span<const std::byte> data)
+{
+    compressed_data.reset(new char[data.size_bytes()]);
+    std::memcpy(compressed_data.get(), data.data(), data.size_bytes());
+    compressed_size = data.size_bytes();
+}
 template class Sz3<float>;
 template class Sz3<double>;
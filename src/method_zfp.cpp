@@ -36,7 +36,7 @@ template <typename F> size_t Zfp<F>::compress(std::span<const F> input)
 
     /* allocate buffer for compressed data */
     bufsize = zfp_stream_maximum_size(zfp, field) + ((ZFP_META_BITS + 8) / 8);
-    compressed_buffer = std::vector<std::byte>(bufsize);
+    compressed_buffer.resize(bufsize);
 
     /* associate bit stream with allocated buffer */
     stream = stream_open(compressed_buffer.data(), bufsize);
@@ -61,13 +61,40 @@ template <typename F> size_t Zfp<F>::compress(std::span<const F> input)
     return zfpsize;
 }
 
+template <typename F> size_t Zfp<F>::decompressed_count()
+{
+    zfp_field *field;  /* array meta data */
+    zfp_stream *zfp;   /* compressed stream */
+    bitstream *stream; /* bit stream to write to or read from */
+
+    field = zfp_field_alloc();
+    stream = stream_open(compressed_buffer.data(), compressed_buffer.size());
+    zfp = zfp_stream_open(stream);
+    zfp_stream_rewind(zfp);
+    zfp_read_header(zfp, field, ZFP_HEADER_META);
+    size_t count = field->nx;
+
+    /* clean up */
+    zfp_field_free(field);
+    zfp_stream_close(zfp);
+    stream_close(stream);
+    return count;
+}
+
 template <typename F> std::span<const F> Zfp<F>::decompress()
+{
+    results.resize(decompressed_count());
+    decompress_into(results);
+    return results;
+}
+
+template <typename F> size_t Zfp<F>::decompress_into(std::span<F> output)
 {
     zfp_field *field;  /* array meta data */
     zfp_stream *zfp;   /* compressed stream */
     bitstream *stream; /* bit stream to write to or read from */
     size_t zfpsize;    /* byte size of compressed stream */
-    
+
     field = zfp_field_alloc();
     stream = stream_open(compressed_buffer.data(), compressed_buffer.size());
     zfp = zfp_stream_open(stream);
@@ -76,8 +103,15 @@ template <typename F> std::span<const F> Zfp<F>::decompress()
     zfp_read_header(zfp, field, ZFP_HEADER_META);
     assert(field->type == get_zfp_type<F>());
     assert(field->sx == 0);
-    results = std::vector<F>(field->nx);
-    zfp_field_set_pointer(field, results.data());
+    size_t count = field->nx;
+    if (output.size() < count)
+    {
+        zfp_field_free(field);
+        zfp_stream_close(zfp);
+        stream_close(stream);
+        throw std::runtime_error("Output buffer too small for " + name());
+    }
+    zfp_field_set_pointer(field, output.data());
     zfpsize = zfp_decompress(zfp, field);
     if (!zfpsize)
     {
@@ -88,7 +122,7 @@ template <typename F> std::span<const F> Zfp<F>::decompress()
     zfp_field_free(field);
     zfp_stream_close(zfp);
     stream_close(stream);
-    return results;
+    return count;
 }
 template class Zfp<float>;
 template class Zfp<double>;
\ No newline at end of file
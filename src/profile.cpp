@@ -0,0 +1,238 @@
+#include "profile.hpp"
+#include "thread_pool.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+static constexpr unsigned hll_bits = 12;
+static constexpr size_t hll_registers = 1 << hll_bits;
+static constexpr size_t min_chunk = 1 << 16;
+
+template <typename F> struct uint_of;
+template <> struct uint_of<float>
+{
+    typedef uint32_t type;
+};
+template <> struct uint_of<double>
+{
+    typedef uint64_t type;
+};
+
+// murmur3 finaliser, good enough to spread bit patterns over the HyperLogLog registers
+static inline uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+template <typename F> struct partial_profile
+{
+    size_t nan_count = 0;
+    size_t inf_count = 0;
+    size_t finite = 0;
+    F min = std::numeric_limits<F>::infinity();
+    F max = -std::numeric_limits<F>::infinity();
+    // moments are shifted by a common value to avoid cancellation, and like the differences taken of scaled values
+    double sum = 0, sum_sq = 0;
+    size_t pairs = 0;
+    double pair_sum_a = 0, pair_sum_b = 0, pair_sum_ab = 0;
+    size_t diff1_count = 0, diff2_count = 0;
+    double diff1 = 0, diff2 = 0;
+    size_t repeats = 0;
+    std::array<std::array<uint64_t, 256>, sizeof(F)> histograms = {};
+    std::array<uint8_t, hll_registers> hll = {};
+};
+
+template <typename F>
+static void profile_range(std::span<const F> data, size_t begin, size_t end, double scale, double shift,
+                          partial_profile<F> &p)
+{
+    typedef typename uint_of<F>::type uint_type;
+    const F *x = data.data();
+    for (size_t i = begin; i < end; i++)
+    {
+        F v = x[i];
+        uint_type bits = std::bit_cast<uint_type>(v);
+        for (size_t b = 0; b < sizeof(F); b++)
+            p.histograms[b][(bits >> (8 * b)) & 0xFF]++;
+        uint64_t h = mix(bits);
+        uint8_t rank = std::countl_zero((h << hll_bits) | (1ull << (hll_bits - 1))) + 1;
+        p.hll[h >> (64 - hll_bits)] = std::max(p.hll[h >> (64 - hll_bits)], rank);
+
+        if (i > 0 && std::bit_cast<uint_type>(x[i - 1]) == bits)
+            p.repeats++;
+        if (std::isnan(v))
+        {
+            p.nan_count++;
+            continue;
+        }
+        if (std::isinf(v))
+        {
+            p.inf_count++;
+            continue;
+        }
+        p.finite++;
+        p.min = std::min(p.min, v);
+        p.max = std::max(p.max, v);
+        double d = v * scale - shift;
+        p.sum += d;
+        p.sum_sq += d * d;
+        if (i > 0 && std::isfinite(x[i - 1]))
+        {
+            double prev = x[i - 1] * scale - shift;
+            p.pairs++;
+            p.pair_sum_a += prev;
+            p.pair_sum_b += d;
+            p.pair_sum_ab += prev * d;
+            p.diff1_count++;
+            p.diff1 += std::abs(v * scale - x[i - 1] * scale);
+            if (i > 1 && std::isfinite(x[i - 2]))
+            {
+                p.diff2_count++;
+                p.diff2 += std::abs(v * scale - 2.0 * (x[i - 1] * scale) + x[i - 2] * scale);
+            }
+        }
+    }
+}
+
+template <typename F> static void merge(partial_profile<F> &into, const partial_profile<F> &p)
+{
+    into.nan_count += p.nan_count;
+    into.inf_count += p.inf_count;
+    into.finite += p.finite;
+    into.min = std::min(into.min, p.min);
+    into.max = std::max(into.max, p.max);
+    into.sum += p.sum;
+    into.sum_sq += p.sum_sq;
+    into.pairs += p.pairs;
+    into.pair_sum_a += p.pair_sum_a;
+    into.pair_sum_b += p.pair_sum_b;
+    into.pair_sum_ab += p.pair_sum_ab;
+    into.diff1_count += p.diff1_count;
+    into.diff2_count += p.diff2_count;
+    into.diff1 += p.diff1;
+    into.diff2 += p.diff2;
+    into.repeats += p.repeats;
+    for (size_t b = 0; b < sizeof(F); b++)
+        for (size_t i = 0; i < 256; i++)
+            into.histograms[b][i] += p.histograms[b][i];
+    for (size_t i = 0; i < hll_registers; i++)
+        into.hll[i] = std::max(into.hll[i], p.hll[i]);
+}
+
+static double hll_estimate(const std::array<uint8_t, hll_registers> &registers)
+{
+    const double m = hll_registers;
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t r : registers)
+    {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros)
+        estimate = m * std::log(m / zeros); // linear counting for small cardinalities
+    return estimate;
+}
+
+template <typename F> data_profile profile_data(std::span<const F> data, size_t threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::clamp<size_t>(data.size() / min_chunk, 1, threads);
+
+    // Squares, products and differences of doubles near the largest finite one overflow, which traps under the
+    // floating point exceptions main enables. Values of magnitude 1 and more are scaled by a power of two, which is
+    // exact, that brings the largest below 1.
+    std::vector<double> max_abs(chunks);
+    parallel_for(chunks, threads, [&](size_t c) {
+        for (size_t i = data.size() * c / chunks; i < data.size() * (c + 1) / chunks; i++)
+            if (std::isfinite(data[i]))
+                max_abs[c] = std::max<double>(max_abs[c], std::abs(data[i]));
+    });
+    int exponent = 0;
+    std::frexp(*std::max_element(max_abs.begin(), max_abs.end()), &exponent);
+    double scale = std::ldexp(1.0, -std::max(exponent, 0));
+
+    double shift = 0;
+    for (F v : data)
+    {
+        if (std::isfinite(v))
+        {
+            shift = v * scale;
+            break;
+        }
+    }
+
+    std::vector<partial_profile<F>> partials(chunks);
+    parallel_for(chunks, threads, [&](size_t c) {
+        profile_range(data, data.size() * c / chunks, data.size() * (c + 1) / chunks, scale, shift, partials[c]);
+    });
+    for (size_t c = 1; c < chunks; c++)
+        merge(partials[0], partials[c]);
+    const partial_profile<F> &p = partials[0];
+
+    // a mean difference can be past the largest double even though the values are not
+    auto unscale = [scale](double scaled) {
+        return scaled <= std::numeric_limits<double>::max() * scale ? scaled / scale
+                                                                    : std::numeric_limits<double>::infinity();
+    };
+    data_profile profile;
+    profile.count = data.size();
+    profile.nan_count = p.nan_count;
+    profile.inf_count = p.inf_count;
+    if (p.finite)
+    {
+        profile.min = p.min;
+        profile.max = p.max;
+    }
+    if (p.pairs)
+    {
+        double n = p.pairs;
+        double mean = p.sum / p.finite;
+        double variance = p.sum_sq / p.finite - mean * mean;
+        double covariance = p.pair_sum_ab / n - (p.pair_sum_a / n) * (p.pair_sum_b / n);
+        profile.lag1_autocorrelation = variance > 0 ? covariance / variance : 0;
+    }
+    if (p.diff1_count)
+        profile.mean_abs_diff1 = unscale(p.diff1 / p.diff1_count);
+    if (p.diff2_count)
+        profile.mean_abs_diff2 = unscale(p.diff2 / p.diff2_count);
+    if (data.size() > 1)
+        profile.repeated_fraction = (double)p.repeats / (data.size() - 1);
+    profile.cardinality = data.empty() ? 0 : std::min<double>(hll_estimate(p.hll), data.size());
+    for (auto &histogram : p.histograms)
+    {
+        double entropy = 0;
+        for (uint64_t count : histogram)
+        {
+            if (count)
+            {
+                double q = (double)count / data.size();
+                entropy -= q * std::log2(q);
+            }
+        }
+        profile.byte_entropy.push_back(entropy);
+    }
+    return profile;
+}
+template data_profile profile_data(std::span<const float> data, size_t threads);
+template data_profile profile_data(std::span<const double> data, size_t threads);
+
+std::string data_profile::byte_entropy_string() const
+{
+    std::string s;
+    for (size_t i = 0; i < byte_entropy.size(); i++)
+        s += string_format(i ? ";%.4f" : "%.4f", byte_entropy[i]);
+    return s;
+}
@@ -0,0 +1,144 @@
+#include "self_test.hpp"
+#include "buffer.hpp"
+#include "encoding.hpp"
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T> using self_test_uint = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+
+template <typename T> static std::vector<std::pair<std::string, std::vector<T>>> self_test_datasets()
+{
+    typedef std::numeric_limits<T> limits;
+    typedef self_test_uint<T> U;
+    std::mt19937_64 rng(42);
+    std::vector<std::pair<std::string, std::vector<T>>> datasets;
+    datasets.emplace_back("empty", std::vector<T>());
+    datasets.emplace_back("one value", std::vector<T>{T(1.5)});
+
+    // every special value next to every other, at an odd length
+    std::vector<T> specials = {T(0),
+                               -T(0),
+                               limits::infinity(),
+                               -limits::infinity(),
+                               limits::quiet_NaN(),
+                               -limits::quiet_NaN(),
+                               std::bit_cast<T>(~U(0)),
+                               std::bit_cast<T>(std::bit_cast<U>(limits::quiet_NaN()) | 1),
+                               limits::denorm_min(),
+                               -limits::denorm_min(),
+                               limits::min(),
+                               limits::max(),
+                               limits::lowest(),
+                               limits::epsilon(),
+                               T(1),
+                               T(-1)};
+    std::vector<T> mixed(1001);
+    for (auto &v : mixed)
+        v = specials[rng() % specials.size()];
+    datasets.emplace_back("special values", mixed);
+
+    std::vector<T> random_bits(4099);
+    for (auto &v : random_bits)
+        v = std::bit_cast<T>(U(rng()));
+    datasets.emplace_back("random bits", random_bits);
+
+    std::vector<T> decimals(10007);
+    for (auto &v : decimals)
+        v = T(int64_t(rng() % 2000000) - 1000000) / T(100);
+    datasets.emplace_back("decimals", decimals);
+
+    std::vector<T> smooth(3001);
+    for (size_t i = 0; i < smooth.size(); i++)
+        smooth[i] = T(std::sin(double(i) * 0.001) * 1000);
+    datasets.emplace_back("smooth", smooth);
+
+    datasets.emplace_back("constant", std::vector<T>(2049, T(42)));
+
+    // more than one default Gorilla block and several ALP row groups, decimals with some real values and specials
+    std::vector<T> large((size_t(1) << 20) + 3);
+    for (size_t i = 0; i < large.size(); i++)
+        large[i] = i % 97 == 0   ? T(std::sin(double(i)))
+                   : i % 1013 == 0 ? specials[i % specials.size()]
+                                   : T(int64_t(rng() % 100000)) / T(1000);
+    datasets.emplace_back("large", large);
+    return datasets;
+}
+
+// an empty string if encoding reproduces input, what went wrong otherwise
+static std::string self_test_round_trip(Encoding &encoding, std::span<const std::byte> input)
+{
+    byte_buffer encoded(encoding.max_encoded_size(input.size()));
+    // every encoding writes a header, so no output buffer is always too small
+    if (encoding.encode_into(input, std::span<std::byte>()) == 0)
+        return "an empty output buffer was not reported as too small";
+    size_t encoded_size = encoding.encode_into(input, encoded);
+    if (encoded_size > encoded.size())
+        return "encoded past max_encoded_size";
+    std::span<const std::byte> stream(encoded.data(), encoded_size);
+    if (encoding.decoded_size(stream) != input.size())
+        return "decoded_size is " + std::to_string(encoding.decoded_size(stream));
+    byte_buffer decoded(input.size());
+    if (encoding.decode_into(stream, decoded) != input.size())
+        return "decoded to the wrong size";
+    if (!input.empty() && std::memcmp(decoded.data(), input.data(), input.size()) != 0)
+        return "decoded to different bits";
+    return "";
+}
+
+template <typename T> static int self_test_type(std::ostream &out, const char *type)
+{
+    std::vector<std::shared_ptr<Encoding>> encodings = {
+        std::make_shared<Gorilla<T>>(),       std::make_shared<Gorilla<T>>(1000), std::make_shared<Chimp<T>>(),
+        std::make_shared<Chimp128<T>>(),      std::make_shared<Alp<T>>(),         std::make_shared<Fpc<T>>(),
+        std::make_shared<Fpc<T>>(20),         std::make_shared<Chunked<Fpc<T>>>(),
+    };
+    int failures = 0;
+    for (auto &[dataset, values] : self_test_datasets<T>())
+    {
+        std::span<const std::byte> input = std::as_bytes(std::span<const T>(values));
+        // the same values one byte off their alignment
+        std::vector<std::byte> shifted(input.size() + 1);
+        if (!input.empty())
+            std::memcpy(shifted.data() + 1, input.data(), input.size());
+        for (auto &encoding : encodings)
+        {
+            for (auto view : {input, std::span<const std::byte>(shifted).subspan(1)})
+            {
+                std::string error;
+                try
+                {
+                    error = self_test_round_trip(*encoding, view);
+                }
+                catch (const std::exception &e)
+                {
+                    error = e.what();
+                }
+                if (error.empty())
+                    continue;
+                out << encoding->name() << " (" << type << ") failed on " << dataset
+                    << (view.data() == input.data() ? "" : " (misaligned)") << ": " << error << std::endl;
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+int self_test(std::ostream &out)
+{
+    int failures = self_test_type<float>(out, "float") + self_test_type<double>(out, "double");
+    out << (failures ? std::to_string(failures) + " round trips failed" : "All round trips passed") << std::endl;
+    return failures;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "small_blocks.hpp"
+#include "buffer.hpp"
+#include "encoding.hpp"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+small_block_result benchmark_small_blocks(std::span<const std::byte> data, size_t block_size, Encoding &encoding)
+{
+    if (block_size == 0)
+        throw std::runtime_error("block size must not be zero");
+    size_t block_count = data.size() / block_size;
+    if (block_count == 0)
+        throw std::runtime_error("dataset is smaller than one block");
+    size_t slot_size = encoding.max_encoded_size(block_size);
+    byte_buffer encoded(block_count * slot_size);
+    byte_buffer decoded(block_count * block_size);
+    std::vector<size_t> encoded_sizes(block_count), decoded_sizes(block_count);
+
+    auto tstart = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < block_count; i++)
+        encoded_sizes[i] = encoding.encode_into(data.subspan(i * block_size, block_size),
+                                                std::span<std::byte>(encoded).subspan(i * slot_size, slot_size));
+    auto tend = std::chrono::high_resolution_clock::now();
+    auto compress_duration = std::chrono::duration<double>(tend - tstart);
+
+    tstart = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < block_count; i++)
+    {
+        std::span<const std::byte> block(encoded.data() + i * slot_size, encoded_sizes[i]);
+        std::span<std::byte> output(decoded.data() + i * block_size, block_size);
+        decoded_sizes[i] = encoding.decode_into(block, output);
+    }
+    tend = std::chrono::high_resolution_clock::now();
+    auto decompress_duration = std::chrono::duration<double>(tend - tstart);
+    for (size_t i = 0; i < block_count; i++)
+        if (decoded_sizes[i] != block_size)
+            throw std::runtime_error(encoding.name() + " decoded block " + std::to_string(i) + " to the wrong size");
+    if (std::memcmp(decoded.data(), data.data(), decoded.size()) != 0)
+        throw std::runtime_error(encoding.name() + " did not reproduce the blocks");
+
+    small_block_result r;
+    r.name = encoding.name();
+    r.block_size = block_size;
+    r.block_count = block_count;
+    r.original_size = block_count * block_size;
+    r.compressed_size = 0;
+    for (size_t sz : encoded_sizes)
+        r.compressed_size += sz;
+    r.compression_time = compress_duration.count();
+    r.decompression_time = decompress_duration.count();
+    return r;
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "storage.hpp"
+#include "method.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+static constexpr size_t direct_alignment = 4096;
+
+struct free_deleter
+{
+    void operator()(std::byte *p)
+    {
+        std::free(p);
+    }
+};
+typedef std::unique_ptr<std::byte[], free_deleter> aligned_buffer;
+
+static size_t align_up(size_t sz)
+{
+    return (sz + direct_alignment - 1) / direct_alignment * direct_alignment;
+}
+
+static aligned_buffer make_aligned_buffer(size_t sz)
+{
+    auto p = static_cast<std::byte *>(std::aligned_alloc(direct_alignment, std::max(align_up(sz), direct_alignment)));
+    if (!p)
+        throw std::bad_alloc();
+    return aligned_buffer(p);
+}
+
+static void check(bool ok, const std::string &what, const std::string &path)
+{
+    if (!ok)
+        throw std::runtime_error(what + " failed for " + path + ": " + std::strerror(errno));
+}
+
+// Evicts the file from the page cache so the read back comes from the device. Dropping every cache needs root, the
+// fadvise fallback only covers this file but works for anyone once the data has been written back.
+static bool drop_cache(int fd)
+{
+    check(fdatasync(fd) == 0, "fdatasync", "benchmark file");
+    bool dropped = false;
+    if (int proc = open("/proc/sys/vm/drop_caches", O_WRONLY); proc >= 0)
+    {
+        dropped = write(proc, "1", 1) == 1;
+        close(proc);
+    }
+    if (!dropped)
+        dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    return dropped;
+}
+
+struct io_times
+{
+    double write_time;
+    double read_time;
+    bool cache_dropped;
+};
+
+// Writes data to a file in the target directory and reads it back into readback, which must have room for
+// align_up(data.size()) bytes.
+static io_times write_read(std::span<const std::byte> data, std::byte *readback, const std::string &file_name,
+                           const storage_options &options)
+{
+    std::string path = options.directory + "/" + file_name;
+    int flags = options.direct ? O_DIRECT : 0;
+    io_times t{};
+
+    // O_DIRECT needs an aligned source and a whole number of blocks, the file is truncated to size afterwards.
+    size_t write_sz = data.size_bytes();
+    const std::byte *src = data.data();
+    aligned_buffer staging;
+    if (options.direct)
+    {
+        write_sz = align_up(data.size_bytes());
+        staging = make_aligned_buffer(write_sz);
+        std::copy(data.begin(), data.end(), staging.get());
+        std::fill(staging.get() + data.size_bytes(), staging.get() + write_sz, std::byte(0));
+        src = staging.get();
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | flags, 0644);
+    check(fd >= 0, "open", path);
+    auto tstart = std::chrono::high_resolution_clock::now();
+    for (size_t done = 0; done < write_sz;)
+    {
+        ssize_t n = write(fd, src + done, write_sz - done);
+        check(n > 0, "write", path);
+        done += n;
+    }
+    if (options.fsync)
+        check(fsync(fd) == 0, "fsync", path);
+    auto tend = std::chrono::high_resolution_clock::now();
+    t.write_time = std::chrono::duration<double>(tend - tstart).count();
+    if (write_sz != data.size_bytes())
+        check(ftruncate(fd, data.size_bytes()) == 0, "ftruncate", path);
+    t.cache_dropped = options.drop_cache && drop_cache(fd);
+    close(fd);
+
+    fd = open(path.c_str(), O_RDONLY | flags);
+    check(fd >= 0, "open", path);
+    size_t read_sz = options.direct ? align_up(data.size_bytes()) : data.size_bytes();
+    size_t done = 0;
+    tstart = std::chrono::high_resolution_clock::now();
+    while (done < read_sz)
+    {
+        ssize_t n = read(fd, readback + done, read_sz - done);
+        check(n >= 0, "read", path);
+        if (n == 0)
+            break;
+        done += n;
+    }
+    tend = std::chrono::high_resolution_clock::now();
+    t.read_time = std::chrono::duration<double>(tend - tstart).count();
+    close(fd);
+    unlink(path.c_str());
+    if (done != data.size_bytes())
+        throw std::runtime_error("short read from " + path);
+    return t;
+}
+
+template <typename F> storage_result benchmark_storage_raw(std::span<const F> original_buffer, storage_options options)
+{
+    auto data = std::as_bytes(original_buffer);
+    auto readback = make_aligned_buffer(data.size_bytes());
+    io_times t = write_read(data, readback.get(), "raw.bin", options);
+    if (!std::equal(data.begin(), data.end(), readback.get()))
+        throw std::runtime_error("raw data read back does not match");
+
+    storage_result r;
+    r.name = "Raw";
+    r.original_size = data.size_bytes();
+    r.compressed_size = data.size_bytes();
+    r.compression_time = 0;
+    r.write_time = t.write_time;
+    r.read_time = t.read_time;
+    r.decompression_time = 0;
+    r.cache_dropped = t.cache_dropped;
+    return r;
+}
+template storage_result benchmark_storage_raw(std::span<const float> original_buffer, storage_options options);
+template storage_result benchmark_storage_raw(std::span<const double> original_buffer, storage_options options);
+
+template <typename F>
+storage_result benchmark_storage(std::span<const F> original_buffer, Method<F> &method, F error_bound,
+                                 storage_options options)
+{
+    method.set_error_bound(error_bound);
+    auto tstart = std::chrono::high_resolution_clock::now();
+    method.compress(original_buffer);
+    auto tend = std::chrono::high_resolution_clock::now();
+    auto compress_duration = std::chrono::duration<double>(tend - tstart);
+
+    std::span<const std::byte> compressed = method.compressed();
+    auto readback = make_aligned_buffer(compressed.size_bytes());
+    io_times t = write_read(compressed, readback.get(), "compressed.bin", options);
+
+    method.load(std::span<const std::byte>(readback.get(), compressed.size_bytes()));
+    tstart = std::chrono::high_resolution_clock::now();
+    auto decompressed = method.decompress();
+    tend = std::chrono::high_resolution_clock::now();
+    auto decompress_duration = std::chrono::duration<double>(tend - tstart);
+    if (decompressed.size() != original_buffer.size())
+        throw std::runtime_error(method.name() + " decompressed the wrong number of values from storage");
+
+    storage_result r;
+    r.name = method.name();
+    r.original_size = original_buffer.size_bytes();
+    r.compressed_size = compressed.size_bytes();
+    r.compression_time = compress_duration.count();
+    r.write_time = t.write_time;
+    r.read_time = t.read_time;
+    r.decompression_time = decompress_duration.count();
+    r.cache_dropped = t.cache_dropped;
+    return r;
+}
+template storage_result benchmark_storage(std::span<const float> original_buffer, Method<float> &method,
+                                          float error_bound, storage_options options);
+template storage_result benchmark_storage(std::span<const double> original_buffer, Method<double> &method,
+                                          double error_bound, storage_options options);
@@ -0,0 +1,157 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+ThreadPool::job::job(std::function<void(size_t)> fn, size_t n, size_t participants)
+    : fn(std::move(fn)), shares(participants), pending(n)
+{
+    for (size_t p = 0; p < participants; p++)
+    {
+        shares[p].begin = n * p / participants;
+        shares[p].end = n * (p + 1) / participants;
+    }
+}
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    for (size_t t = 0; t < threads; t++)
+        workers.emplace_back([this]() { worker_loop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : workers)
+        t.join();
+}
+
+static std::atomic<size_t> concurrent_jobs = 1;
+
+void set_concurrent_jobs(size_t jobs)
+{
+    concurrent_jobs = std::max<size_t>(jobs, 1);
+}
+
+size_t threads_per_job()
+{
+    return std::max<size_t>(std::thread::hardware_concurrency() / concurrent_jobs, 1);
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+bool ThreadPool::take(job &j, size_t slot, size_t &index)
+{
+    {
+        auto &own = j.shares[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end)
+        {
+            index = own.begin++;
+            return true;
+        }
+    }
+    for (size_t k = 1; k < j.shares.size(); k++)
+    {
+        auto &victim = j.shares[(slot + k) % j.shares.size()];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end)
+                continue;
+            end = victim.end;
+            begin = end - (end - victim.begin + 1) / 2;
+            victim.end = begin;
+        }
+        auto &own = j.shares[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin + 1;
+        own.end = end;
+        index = begin;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::work(job &j, size_t slot)
+{
+    size_t index;
+    while (take(j, slot, index))
+    {
+        if (!j.failed)
+        {
+            try
+            {
+                j.fn(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(j.mutex);
+                if (!j.error)
+                    j.error = std::current_exception();
+                j.failed = true;
+            }
+        }
+        if (--j.pending == 0)
+        {
+            std::lock_guard<std::mutex> lock(j.mutex);
+            j.done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::worker_loop()
+{
+    auto open_job = [this]() {
+        return std::find_if(jobs.begin(), jobs.end(), [](auto &j) { return j->claimed < j->shares.size(); });
+    };
+    for (;;)
+    {
+        std::shared_ptr<job> j;
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || open_job() != jobs.end(); });
+            if (stopping)
+                return;
+            j = *open_job();
+            slot = j->claimed++;
+        }
+        work(*j, slot);
+    }
+}
+
+void ThreadPool::run_job(std::function<void(size_t)> fn, size_t n, size_t max_threads)
+{
+    auto j = std::make_shared<job>(std::move(fn), n, std::min({n, max_threads, size()}));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(j);
+    }
+    wake.notify_all();
+    work(*j, 0);
+    {
+        // nothing is left to take, so stop handing the job out
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.erase(std::find(jobs.begin(), jobs.end(), j));
+    }
+    {
+        std::unique_lock<std::mutex> lock(j->mutex);
+        j->done.wait(lock, [&]() { return j->pending == 0; });
+    }
+    if (j->error)
+        std::rethrow_exception(j->error);
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <map>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -22,10 +23,69 @@ template <typename F> std::vector<std::shared_ptr<Method<F>>> get_all_common_met
     std::vector<std::shared_ptr<Method<F>>> methods;
     for (auto &e : encodings)
         methods.emplace_back(std::make_shared<Lossless<F>>(e));
+    // the zstd speed/ratio curve, the default level 3 is in encodings above
+    for (int level : {-5, -1, 1, 9, 19})
+    {
+        zstd_params params;
+        params.level = level;
+        methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Zstd>(params)));
+        methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Zstd>>(params)));
+    }
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Zstd>(zstd_params{19, 9, 24, 0, 0})));
+    methods.emplace_back(std::make_shared<Lossless<F>>(
+        std::make_shared<Compose<StreamSplit<F>, Zstd>>(zstd_params{3, 0, 0, 0, 2})));
+    // the lz4 speed/ratio curve, from the fast accelerations to the strongest HC level, the default is in encodings
+    std::vector<lz4_params> lz4_variants;
+    for (int acceleration : {4, 16, 64})
+        lz4_variants.push_back({.acceleration = acceleration});
+    for (int level : {3, 6, 9, 12})
+        lz4_variants.push_back({.hc_level = level});
+    // successive 16 KiB chunks of one series, each able to match into the chunks before it
+    lz4_variants.push_back({.linked_block = 16 << 10});
+    lz4_variants.push_back({.hc_level = 9, .linked_block = 16 << 10});
+    for (auto &params : lz4_variants)
+    {
+        methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Lz4>(params)));
+        methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Lz4>>(params)));
+    }
+    // bsc block sorters, coders, LZP and libbsc's own OpenMP threads, the default is in encodings
+    std::vector<bsc_params> bsc_variants = {{.block_sorter = 4},
+                                            {.block_sorter = 6},
+                                            {.coder = 1},
+                                            {.coder = 2},
+                                            {.lzp_hash_size = 16, .lzp_min_len = 128},
+                                            {.multithreaded = true}};
+    for (auto &params : bsc_variants)
+    {
+        methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Bsc>(params)));
+        methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Bsc>>(params)));
+    }
+    // large inputs as 4 MiB bsc blocks compressed in parallel, bsc's strength grows with the block size
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Bsc>>(size_t(4) << 20)));
+    methods.emplace_back(
+        std::make_shared<Lossless<F>>(std::make_shared<Chunked<Bsc>>(size_t(4) << 20, bsc_params{.block_sorter = 4})));
+    methods.emplace_back(
+        std::make_shared<Lossless<F>>(std::make_shared<Chunked<Compose<StreamSplit<F>, Bsc>>>(size_t(4) << 20)));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Pcodec<F, p_float>>()));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Pcodec<F, p_int>>()));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Pcodec<F, p_uint>>()));
+    for (unsigned level : {4u, 12u})
+        methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Pcodec<F, p_float>>(level)));
+    // chunks of pcodec's default 2^18 values, compressed and decompressed in parallel
+    size_t pcodec_chunk = (size_t(1) << 18) * sizeof(F);
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Pcodec<F, p_float>>>(pcodec_chunk)));
+    methods.emplace_back(
+        std::make_shared<Lossless<F>>(std::make_shared<Chunked<Pcodec<F, p_float>>>(pcodec_chunk, 4u)));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Gorilla<F>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chimp<F>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chimp128<F>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Alp<F>>()));
+    // short blocks trade a little ratio for decoding any 2^16 values on their own
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Gorilla<F>>(size_t(1) << 16)));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Fpc<F>>()));
+    // FPC's original large table, and 1 MiB blocks of the default one in parallel
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Fpc<F>>(20u)));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Fpc<F>>>()));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Bsc>>()));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Zstd>>()));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Lz4>>()));
@@ -35,6 +95,22 @@ template <typename F> std::vector<std::shared_ptr<Method<F>>> get_all_common_met
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Gorilla<F>, Zstd>>()));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Gorilla<F>, Lz4>>()));
     methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Gorilla<F>, Snappy>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp<F>, Bsc>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp<F>, Zstd>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp<F>, Lz4>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp<F>, Snappy>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp128<F>, Bsc>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp128<F>, Zstd>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp128<F>, Lz4>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<Chimp128<F>, Snappy>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Bsc>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Zstd>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Lz4>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Snappy>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Compose<StreamSplit<F>, Bsc>>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Compose<StreamSplit<F>, Zstd>>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Compose<StreamSplit<F>, Lz4>>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Chunked<Compose<StreamSplit<F>, Snappy>>>()));
 
     for (auto &e : encodings)
     {
@@ -78,6 +154,9 @@ template <typename F> std::vector<std::shared_ptr<Method<F>>> get_all_common_met
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Pcodec<F, p_int>>()));
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Pcodec<F, p_uint>>()));
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Gorilla<F>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Chimp<F>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Chimp128<F>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Alp<F>>()));
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<StreamSplit<F>, Bsc>>()));
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<StreamSplit<F>, Zstd>>()));
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<StreamSplit<F>, Lz4>>()));
@@ -87,6 +166,14 @@ template <typename F> std::vector<std::shared_ptr<Method<F>>> get_all_common_met
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Gorilla<F>, Zstd>>()));
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Gorilla<F>, Lz4>>()));
     methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Gorilla<F>, Snappy>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp<F>, Bsc>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp<F>, Zstd>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp<F>, Lz4>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp<F>, Snappy>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp128<F>, Bsc>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp128<F>, Zstd>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp128<F>, Lz4>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<Compose<Chimp128<F>, Snappy>>()));
 
     for (auto &e : encodings)
     {
@@ -96,6 +183,9 @@ template <typename F> std::vector<std::shared_ptr<Method<F>>> get_all_common_met
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Pcodec<F, p_int>>()));
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Pcodec<F, p_uint>>()));
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Gorilla<F>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Chimp<F>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Chimp128<F>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Alp<F>>()));
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<StreamSplit<F>, Bsc>>()));
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<StreamSplit<F>, Zstd>>()));
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<StreamSplit<F>, Lz4>>()));
@@ -105,6 +195,14 @@ template <typename F> std::vector<std::shared_ptr<Method<F>>> get_all_common_met
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Gorilla<F>, Zstd>>()));
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Gorilla<F>, Lz4>>()));
     methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Gorilla<F>, Snappy>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp<F>, Bsc>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp<F>, Zstd>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp<F>, Lz4>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp<F>, Snappy>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp128<F>, Bsc>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp128<F>, Zstd>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp128<F>, Lz4>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<Compose<Chimp128<F>, Snappy>>()));
 
     methods.emplace_back(std::make_shared<Sz3<F>>());
     methods.emplace_back(std::make_shared<Zfp<F>>());
@@ -122,14 +220,49 @@ template <> std::vector<std::shared_ptr<Method<double>>> get_all_methods()
     return methods;
 }
 
+template <typename F> std::vector<std::shared_ptr<Method<F>>> get_optional_methods()
+{
+    std::vector<std::shared_ptr<Method<F>>> methods;
+    // so far no better than Stream Split with the same backend
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<TiledSplit<F, Zstd>>()));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<TiledSplit<F, Lz4>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<TiledSplit<F, Zstd>>()));
+    methods.emplace_back(std::make_shared<Mask<F>>(std::make_shared<TiledSplit<F, Lz4>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<TiledSplit<F, Zstd>>()));
+    methods.emplace_back(std::make_shared<IntFloat<F>>(std::make_shared<TiledSplit<F, Lz4>>()));
+    // zstd's own worker threads and long distance matching, for arrays far larger than the default window; every
+    // thread that runs an ldm method keeps a context with a 128 MiB window
+    zstd_params mt = {.workers = -1};
+    zstd_params ldm = {.window_log = 27, .long_distance = true};
+    zstd_params mt_ldm = {.level = 19, .window_log = 27, .workers = -1, .long_distance = true};
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Zstd>(mt)));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Zstd>(ldm)));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Zstd>(mt_ldm)));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Zstd>>(mt)));
+    methods.emplace_back(std::make_shared<Lossless<F>>(std::make_shared<Compose<StreamSplit<F>, Zstd>>(ldm)));
+    return methods;
+}
+template std::vector<std::shared_ptr<Method<float>>> get_optional_methods<float>();
+template std::vector<std::shared_ptr<Method<double>>> get_optional_methods<double>();
+
+template <typename F> std::vector<std::shared_ptr<Method<F>>> get_named_methods()
+{
+    auto methods = get_all_methods<F>();
+    auto optional = get_optional_methods<F>();
+    methods.insert(methods.end(), optional.begin(), optional.end());
+    return methods;
+}
+template std::vector<std::shared_ptr<Method<float>>> get_named_methods<float>();
+template std::vector<std::shared_ptr<Method<double>>> get_named_methods<double>();
+
 std::vector<std::string> get_all_names()
 {
     std::map<std::string, std::string> names;
-    for (auto &m : get_all_methods<float>())
+    for (auto &m : get_named_methods<float>())
     {
         names.insert({m->name(), std::string("float")});
     }
-    for (auto &m : get_all_methods<double>())
+    for (auto &m : get_named_methods<double>())
     {
         auto val = names.find(m->name());
         if (val == names.end())
@@ -171,6 +304,16 @@ void table_to_file(std::string path, tabulate::Table &table)
     }
 }
 
+std::vector<std::string> split_string(const std::string &str, char delim)
+{
+    std::vector<std::string> parts;
+    std::istringstream s(str);
+    std::string part;
+    while (std::getline(s, part, delim))
+        parts.push_back(part);
+    return parts;
+}
+
 template <typename T> void vec_to_file(std::string path, const std::vector<T> &data)
 {
     if (std::FILE *f = std::fopen(path.c_str(), "wb"))